@@ -0,0 +1,517 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Batch.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <deque>
+#include <string_view>
+#include <utility>
+#include "Emulator.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+    enum class Kind : Byte {NONE, LOAD, STORE, ADC, SBC, AND, ORA, EOR, CMP, BIT,
+                            INCREMENT, DECREMENT, SET, CLEAR, NOP, BRANCH, JMP};
+    enum class Mode : Byte {NONE, IMPLIED, IM, ZP, ZPX, ZPY, ABS, ABX, ABY, INDX, INDY};
+    enum LaneReg : Byte {REG_A, REG_X, REG_Y};
+
+    struct LaneOp {
+        Kind kind = Kind::NONE;
+        Mode mode = Mode::NONE;
+        Byte reg = REG_A;     //Register loaded, stored, compared or stepped
+        Byte mask = 0;        //Status bits for SET/CLEAR/BRANCH
+        bool whenSet = false; //BRANCH taken when the masked bit is set
+        Byte bytes = 0;       //Operand bytes
+        Byte cycles = 0;      //Base cycles from Opcodes.def, without page-cross and branch penalties
+    };
+
+    constexpr Byte FLAG_C = 0x01, FLAG_Z = 0x02, FLAG_I = 0x04, FLAG_D = 0x08, FLAG_V = 0x40, FLAG_N = 0x80;
+    constexpr int32_t NO_LANE = INT32_MAX;
+
+    constexpr Mode parseMode(const std::string_view mode) {
+        constexpr std::pair<std::string_view, Mode> modes[] = {
+            {"IM", Mode::IM}, {"ZP", Mode::ZP}, {"ZPX", Mode::ZPX}, {"ZPY", Mode::ZPY}, {"ABS", Mode::ABS},
+            {"ABX", Mode::ABX}, {"ABY", Mode::ABY}, {"INDX", Mode::INDX}, {"INDY", Mode::INDY}};
+        for (const auto &[name, value] : modes) {
+            if (name == mode) return value;
+        }
+        return Mode::NONE; //ACC and IN stay on the interpreter
+    }
+
+    // Classifies one Opcodes.def handler, e.g. "ORA<INDX>"
+    constexpr LaneOp laneOp(const std::string_view handler, const Byte bytes, const Byte cycles) {
+        const std::string_view name = handler.substr(0, 3);
+        const size_t open = handler.find('<');
+        const Mode mode = open == std::string_view::npos
+            ? (bytes ? Mode::IM : Mode::IMPLIED)
+            : parseMode(handler.substr(open + 1, handler.size() - open - 2));
+
+        constexpr std::pair<std::string_view, LaneOp> ops[] = {
+            {"LDA", {Kind::LOAD, {}, REG_A}}, {"LDX", {Kind::LOAD, {}, REG_X}}, {"LDY", {Kind::LOAD, {}, REG_Y}},
+            {"STA", {Kind::STORE, {}, REG_A}}, {"STX", {Kind::STORE, {}, REG_X}}, {"STY", {Kind::STORE, {}, REG_Y}},
+            {"ADC", {Kind::ADC}}, {"SBC", {Kind::SBC}}, {"AND", {Kind::AND}}, {"ORA", {Kind::ORA}},
+            {"EOR", {Kind::EOR}}, {"BIT", {Kind::BIT}},
+            {"CMP", {Kind::CMP, {}, REG_A}}, {"CPX", {Kind::CMP, {}, REG_X}}, {"CPY", {Kind::CMP, {}, REG_Y}},
+            {"INY", {Kind::INCREMENT, {}, REG_Y}}, {"DEY", {Kind::DECREMENT, {}, REG_Y}},
+            {"SEC", {Kind::SET, {}, REG_A, FLAG_C}}, {"CLC", {Kind::CLEAR, {}, REG_A, FLAG_C}},
+            {"SED", {Kind::SET, {}, REG_A, FLAG_D}}, {"CLD", {Kind::CLEAR, {}, REG_A, FLAG_D}},
+            {"SEI", {Kind::SET, {}, REG_A, FLAG_I}}, {"CLI", {Kind::CLEAR, {}, REG_A, FLAG_I}},
+            {"CLV", {Kind::CLEAR, {}, REG_A, FLAG_V}}, {"NOP", {Kind::NOP}},
+            {"BPL", {Kind::BRANCH, {}, REG_A, FLAG_N, false}}, {"BMI", {Kind::BRANCH, {}, REG_A, FLAG_N, true}},
+            {"BVC", {Kind::BRANCH, {}, REG_A, FLAG_V, false}}, {"BVS", {Kind::BRANCH, {}, REG_A, FLAG_V, true}},
+            {"BCC", {Kind::BRANCH, {}, REG_A, FLAG_C, false}}, {"BCS", {Kind::BRANCH, {}, REG_A, FLAG_C, true}},
+            {"BNE", {Kind::BRANCH, {}, REG_A, FLAG_Z, false}}, {"BEQ", {Kind::BRANCH, {}, REG_A, FLAG_Z, true}},
+            {"JMP", {Kind::JMP}}};
+
+        for (const auto &[opName, op] : ops) {
+            if (opName != name || mode == Mode::NONE) continue;
+            if (op.kind == Kind::JMP && mode != Mode::ABS) break;
+            LaneOp result = op;
+            result.mode = mode;
+            result.bytes = bytes;
+            result.cycles = cycles;
+            return result;
+        }
+        return {};
+    }
+
+    // Opcodes the vector path executes, everything else goes to the interpreter
+    constexpr std::array<LaneOp, 256> laneOps = {
+#define OPCODE(code, handler, bytes, cycles) laneOp(#handler, bytes, cycles),
+#include "Opcodes.def"
+#undef OPCODE
+    };
+
+#ifdef __AVX2__
+    struct Avx2 {
+        using V = __m256i;
+        static V load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(int32_t* p, const V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        static V set(const int32_t value) { return _mm256_set1_epi32(value); }
+        static V add(const V a, const V b) { return _mm256_add_epi32(a, b); }
+        static V sub(const V a, const V b) { return _mm256_sub_epi32(a, b); }
+        static V min(const V a, const V b) { return _mm256_min_epi32(a, b); }
+        static V bitAnd(const V a, const V b) { return _mm256_and_si256(a, b); }
+        static V bitOr(const V a, const V b) { return _mm256_or_si256(a, b); }
+        static V bitXor(const V a, const V b) { return _mm256_xor_si256(a, b); }
+        static V equal(const V a, const V b) { return _mm256_cmpeq_epi32(a, b); }
+        static V greater(const V a, const V b) { return _mm256_cmpgt_epi32(a, b); }
+        template<int bits> static V shiftLeft(const V a) { return _mm256_slli_epi32(a, bits); }
+        template<int bits> static V shiftRight(const V a) { return _mm256_srli_epi32(a, bits); }
+        static V select(const V mask, const V a, const V b) { return _mm256_blendv_epi8(b, a, mask); }
+        static bool none(const V mask) { return _mm256_testz_si256(mask, mask); }
+        static int count(const V mask) { return __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask))); }
+
+        static int32_t lowest(const V a) {
+            __m128i m = _mm_min_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+            m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+            m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(m);
+        }
+
+        // The dword ending at the wanted byte never leaves that lane's Memory
+        static V gatherByte(const Byte* base, const V offsets) {
+            const V dwords = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base - 3), offsets, 1);
+            return _mm256_srli_epi32(dwords, 24);
+        }
+    };
+#endif
+
+    struct Scalar {
+        struct V { int32_t lane[Batch::WIDTH]; };
+
+        template<class F> static V each(const V a, const V b, F f) {
+            V result;
+            for (size_t i = 0; i < Batch::WIDTH; i++) result.lane[i] = f(a.lane[i], b.lane[i]);
+            return result;
+        }
+
+        static V load(const int32_t* p) { V v; for (size_t i = 0; i < Batch::WIDTH; i++) v.lane[i] = p[i]; return v; }
+        static void store(int32_t* p, const V v) { for (size_t i = 0; i < Batch::WIDTH; i++) p[i] = v.lane[i]; }
+        static V set(const int32_t value) { V v; for (int32_t &lane : v.lane) lane = value; return v; }
+        static V add(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x + y; }); }
+        static V sub(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x - y; }); }
+        static V min(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x < y ? x : y; }); }
+        static V bitAnd(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x & y; }); }
+        static V bitOr(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x | y; }); }
+        static V bitXor(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x ^ y; }); }
+        static V equal(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x == y ? -1 : 0; }); }
+        static V greater(const V a, const V b) { return each(a, b, [](int32_t x, int32_t y) { return x > y ? -1 : 0; }); }
+        template<int bits> static V shiftLeft(const V a) {
+            return each(a, a, [](int32_t x, int32_t) { return static_cast<int32_t>(static_cast<uint32_t>(x) << bits); });
+        }
+        template<int bits> static V shiftRight(const V a) {
+            return each(a, a, [](int32_t x, int32_t) { return static_cast<int32_t>(static_cast<uint32_t>(x) >> bits); });
+        }
+        static V select(const V mask, const V a, const V b) {
+            V result;
+            for (size_t i = 0; i < Batch::WIDTH; i++) result.lane[i] = mask.lane[i] ? a.lane[i] : b.lane[i];
+            return result;
+        }
+        static bool none(const V mask) {
+            for (const int32_t lane : mask.lane) if (lane) return false;
+            return true;
+        }
+        static int count(const V mask) {
+            int result = 0;
+            for (const int32_t lane : mask.lane) result += lane != 0;
+            return result;
+        }
+        static int32_t lowest(const V a) {
+            int32_t result = a.lane[0];
+            for (const int32_t lane : a.lane) result = lane < result ? lane : result;
+            return result;
+        }
+        static V gatherByte(const Byte* base, const V offsets) {
+            V result;
+            for (size_t i = 0; i < Batch::WIDTH; i++) result.lane[i] = base[offsets.lane[i]];
+            return result;
+        }
+    };
+
+#ifdef __AVX2__
+    using Backend = Avx2;
+#else
+    using Backend = Scalar;
+#endif
+
+    template<class S>
+    typename S::V setNZ(const typename S::V status, const typename S::V value) {
+        const auto zero = S::bitAnd(S::equal(value, S::set(0)), S::set(FLAG_Z));
+        return S::bitOr(S::bitAnd(status, S::set(0x7D)), S::bitOr(S::bitAnd(value, S::set(FLAG_N)), zero));
+    }
+
+    // left + addend + carry in, with C and V set the way ADC sets them
+    template<class S>
+    typename S::V addWithCarry(typename S::V &status, const typename S::V left, const typename S::V addend) {
+        const auto sum = S::add(S::add(left, addend), S::bitAnd(status, S::set(FLAG_C)));
+        const auto result = S::bitAnd(sum, S::set(0xFF));
+        const auto sameSign = S::bitXor(S::bitXor(left, addend), S::set(-1));
+        const auto overflow = S::template shiftRight<1>(S::bitAnd(S::bitAnd(sameSign, S::bitXor(left, result)), S::set(0x80)));
+        status = S::bitOr(S::bitAnd(status, S::set(0xFF & ~(FLAG_C | FLAG_V))),
+                          S::bitOr(S::template shiftRight<8>(sum), overflow));
+        return result;
+    }
+
+    // Little-endian word at a zero page pointer, high byte wrapping like Cpu::readWord
+    template<class S>
+    typename S::V readPointer(const Byte* base, const typename S::V offset, const typename S::V pointer) {
+        const auto low = S::gatherByte(base, S::add(offset, pointer));
+        const auto high = S::gatherByte(base, S::add(offset, S::bitAnd(S::add(pointer, S::set(1)), S::set(0xFF))));
+        return S::bitOr(low, S::template shiftLeft<8>(high));
+    }
+
+    // 1 where from and to lie in different pages, the extra cycle Cpu::addCycles charges
+    template<class S>
+    typename S::V pageCross(const typename S::V from, const typename S::V to) {
+        const auto samePage = S::equal(S::bitAnd(from, S::set(0xFF00)), S::bitAnd(to, S::set(0xFF00)));
+        return S::bitAnd(S::bitXor(samePage, S::set(-1)), S::set(1));
+    }
+
+    // One instruction for every lane that is at pc with the same opcode, WIDTH
+    // lanes per step. Returns the lowest PC any lane still has budget at.
+    template<class S>
+    int32_t stepGroup(Batch::Lanes &r, std::deque<Memory> &memories, const Byte* base, const LaneOp op,
+                      const Byte opcode, const Word pc, const size_t begin, const size_t end, uint64_t &retired) {
+        using V = typename S::V;
+        const bool store = op.kind == Kind::STORE;
+        const auto next = static_cast<Word>(pc + 1 + op.bytes);
+        int32_t* registers[3] = {r.A.data(), r.X.data(), r.Y.data()};
+        const V zero = S::set(0);
+        V lowest = S::set(NO_LANE);
+
+        for (size_t i = begin; i < end; i += Batch::WIDTH) {
+            const V pcs = S::load(&r.PC[i]);
+            const V cycles = S::load(&r.cycles[i]);
+            const V live = S::greater(cycles, zero);
+            const V offset = S::load(&r.memoryOffset[i]);
+            V active = S::bitAnd(live, S::equal(pcs, S::set(pc)));
+            if (!S::none(active)) {
+                // Lanes at the same PC may still hold different code there
+                const V code = S::gatherByte(base, S::add(offset, S::set(pc)));
+                active = S::bitAnd(active, S::equal(code, S::set(opcode)));
+            }
+            if (S::none(active)) {
+                lowest = S::min(lowest, S::select(live, pcs, S::set(NO_LANE)));
+                continue;
+            }
+            retired += S::count(active);
+
+            V operand = zero;
+            if (op.bytes >= 1) {
+                operand = S::gatherByte(base, S::add(offset, S::set(static_cast<Word>(pc + 1))));
+            }
+            if (op.bytes == 2) {
+                const V high = S::gatherByte(base, S::add(offset, S::set(static_cast<Word>(pc + 2))));
+                operand = S::bitOr(operand, S::template shiftLeft<8>(high));
+            }
+
+            const V x = S::load(&r.X[i]);
+            const V y = S::load(&r.Y[i]);
+            V cost = S::set(op.cycles);
+
+            // Effective address, with the same wrapping as Cpu::getValueFromAddress / Cpu::getAddress
+            V address = operand;
+            switch (op.mode) {
+                case Mode::ZPX:
+                case Mode::ZPY:
+                    address = S::add(operand, op.mode == Mode::ZPX ? x : y);
+                    if (!store) address = S::bitAnd(address, S::set(0xFF));
+                    break;
+                case Mode::ABX:
+                case Mode::ABY: {
+                    address = S::bitAnd(S::add(operand, op.mode == Mode::ABX ? x : y), S::set(0xFFFF));
+                    if (!store) {
+                        cost = S::add(cost, pageCross<S>(operand, address));
+                    }
+                    break;
+                }
+                case Mode::INDX: {
+                    V pointer = S::add(operand, x);
+                    if (!store) pointer = S::bitAnd(pointer, S::set(0xFF));
+                    address = readPointer<S>(base, offset, pointer);
+                    break;
+                }
+                case Mode::INDY: {
+                    const V pointer = readPointer<S>(base, offset, operand);
+                    address = S::bitAnd(S::add(pointer, y), S::set(0xFFFF));
+                    if (!store) {
+                        cost = S::add(cost, pageCross<S>(pointer, address));
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            V value = operand;
+            if (!store && op.mode != Mode::IM && op.mode != Mode::IMPLIED && op.kind != Kind::JMP) {
+                value = S::gatherByte(base, S::add(offset, address));
+            }
+
+            const V reg = S::load(&registers[op.reg][i]);
+            V result = reg;
+            V status = S::load(&r.P[i]);
+            V pcAfter = S::set(next);
+
+            switch (op.kind) {
+                case Kind::LOAD:
+                    result = value;
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::STORE: {
+                    int32_t mask[Batch::WIDTH], where[Batch::WIDTH], data[Batch::WIDTH];
+                    S::store(mask, active);
+                    S::store(where, address);
+                    S::store(data, reg);
+                    for (size_t lane = 0; lane < Batch::WIDTH; lane++) {
+                        if (mask[lane]) {
+                            memories[i + lane].writeByte(static_cast<Word>(where[lane]), static_cast<Byte>(data[lane]));
+                        }
+                    }
+                    break;
+                }
+                case Kind::ADC:
+                    result = addWithCarry<S>(status, reg, value);
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::SBC:
+                    result = addWithCarry<S>(status, reg, S::bitXor(value, S::set(0xFF)));
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::AND:
+                    result = S::bitAnd(reg, value);
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::ORA:
+                    result = S::bitOr(reg, value);
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::EOR:
+                    result = S::bitXor(reg, value);
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::CMP: {
+                    const V sum = S::add(S::add(reg, S::bitXor(value, S::set(0xFF))), S::set(1));
+                    status = S::bitOr(S::bitAnd(status, S::set(0xFF & ~FLAG_C)), S::template shiftRight<8>(sum));
+                    status = setNZ<S>(status, S::bitAnd(sum, S::set(0xFF)));
+                    break;
+                }
+                case Kind::BIT: {
+                    const V zeroBit = S::bitAnd(S::equal(S::bitAnd(reg, value), zero), S::set(FLAG_Z));
+                    status = S::bitAnd(status, S::set(0xFF & ~(FLAG_N | FLAG_V | FLAG_Z)));
+                    status = S::bitOr(status, S::bitOr(S::bitAnd(value, S::set(FLAG_N | FLAG_V)), zeroBit));
+                    break;
+                }
+                case Kind::INCREMENT:
+                    result = S::bitAnd(S::add(reg, S::set(1)), S::set(0xFF));
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::DECREMENT:
+                    result = S::bitAnd(S::sub(reg, S::set(1)), S::set(0xFF));
+                    status = setNZ<S>(status, result);
+                    break;
+                case Kind::SET:
+                    status = S::bitOr(status, S::set(op.mask));
+                    break;
+                case Kind::CLEAR:
+                    status = S::bitAnd(status, S::set(0xFF & ~op.mask));
+                    break;
+                case Kind::BRANCH: {
+                    // Same target and page-cross rule as Cpu::branch
+                    const V clear = S::equal(S::bitAnd(status, S::set(op.mask)), zero);
+                    const V taken = op.whenSet ? S::bitXor(clear, S::set(-1)) : clear;
+                    const V signedOffset = S::sub(S::bitXor(operand, S::set(0x80)), S::set(0x80));
+                    const V target = S::bitAnd(S::add(S::set(next - 1), signedOffset), S::set(0xFFFF));
+                    const V extra = S::add(S::set(1), pageCross<S>(S::set(next), target));
+                    cost = S::add(cost, S::bitAnd(taken, extra));
+                    pcAfter = S::select(taken, target, pcAfter);
+                    break;
+                }
+                case Kind::JMP:
+                    pcAfter = operand;
+                    break;
+                default:
+                    break;
+            }
+
+            const V newPC = S::select(active, pcAfter, pcs);
+            const V newCycles = S::select(active, S::sub(cycles, cost), cycles);
+            const V totalCycles = S::load(&r.totalCycles[i]);
+            S::store(&registers[op.reg][i], S::select(active, result, reg));
+            S::store(&r.P[i], S::select(active, status, S::load(&r.P[i])));
+            S::store(&r.PC[i], newPC);
+            S::store(&r.cycles[i], newCycles);
+            S::store(&r.totalCycles[i], S::select(active, S::add(totalCycles, cost), totalCycles));
+            lowest = S::min(lowest, S::select(S::greater(newCycles, zero), newPC, S::set(NO_LANE)));
+        }
+        return S::lowest(lowest);
+    }
+}
+
+Batch::Batch(const size_t lanes)
+    : lanes(lanes), storage(std::make_unique<Byte[]>(SLACK + lanes * 0x10000)) {
+    const size_t padded = (lanes + WIDTH - 1) / WIDTH * WIDTH;
+    for (std::vector<int32_t>* column : {&regs.PC, &regs.A, &regs.X, &regs.Y, &regs.SP, &regs.P,
+                                         &regs.cycles, &regs.totalCycles, &regs.memoryOffset}) {
+        column->assign(padded, 0);
+    }
+    cycleBase.assign(lanes, 0);
+    for (size_t lane = 0; lane < lanes; lane++) {
+        memories.emplace_back(storage.get() + SLACK + lane * 0x10000);
+        if (lane > INT32_MAX / 0x10000 - 1) {
+            Emulator::log(0, Emulator::ERROR, "Too many lanes for one batch: ", std::to_string(lanes));
+            continue;
+        }
+        regs.memoryOffset[lane] = static_cast<int32_t>(lane * 0x10000);
+    }
+    interpreter = std::make_unique<Cpu>(memories.front());
+    reset();
+}
+
+Batch::~Batch() = default;
+
+void Batch::reset() {
+    for (size_t lane = 0; lane < lanes; lane++) {
+        const Memory &memory = memories[lane];
+        setState(lane, {static_cast<Word>(memory[0xFFFC] | (memory[0xFFFD] << 8)), 0, 0, 0, 0xFF, 0x20, 0});
+    }
+    retired = 0;
+}
+
+Cpu::State Batch::state(const size_t lane) const {
+    return {static_cast<Word>(regs.PC[lane]), static_cast<Byte>(regs.A[lane]), static_cast<Byte>(regs.X[lane]),
+            static_cast<Byte>(regs.Y[lane]), static_cast<Byte>(regs.SP[lane]), static_cast<Byte>(regs.P[lane]),
+            cycleBase[lane] + static_cast<uint32_t>(regs.totalCycles[lane])};
+}
+
+void Batch::setState(const size_t lane, const Cpu::State &state) {
+    regs.PC[lane] = state.PC;
+    regs.A[lane] = state.A;
+    regs.X[lane] = state.X;
+    regs.Y[lane] = state.Y;
+    regs.SP[lane] = state.SP;
+    regs.P[lane] = state.status;
+    regs.totalCycles[lane] = 0;
+    cycleBase[lane] = state.totalCycles;
+}
+
+int32_t Batch::lowestPC(const size_t begin, const size_t end) const {
+    int32_t pc = NO_LANE;
+    for (size_t lane = begin; lane < end; lane++) {
+        pc = regs.cycles[lane] > 0 && regs.PC[lane] < pc ? regs.PC[lane] : pc;
+    }
+    return pc;
+}
+
+void Batch::stepLane(const size_t lane) {
+    interpreter->loadState(state(lane));
+    int cycles = regs.cycles[lane];
+    interpreter->step<TraceLevel::OFF>(cycles, memories[lane]);
+    regs.cycles[lane] = cycles;
+    setState(lane, interpreter->saveState());
+}
+
+void Batch::execute(const int cycles) {
+    for (size_t lane = 0; lane < lanes; lane++) {
+        regs.cycles[lane] = cycles;
+        //Gathers read the lane's RAM directly, so lanes with devices run on the interpreter
+        while (memories[lane].hasDevices() && regs.cycles[lane] > 0) {
+            stepLane(lane);
+            retired++;
+        }
+    }
+    for (size_t begin = 0; begin < lanes; begin += TILE) {
+        runTile(begin, std::min(begin + TILE, regs.PC.size()));
+    }
+    for (size_t lane = 0; lane < lanes; lane++) {
+        cycleBase[lane] += static_cast<uint32_t>(regs.totalCycles[lane]);
+        regs.totalCycles[lane] = 0;
+    }
+}
+
+// Each round picks the lowest PC any live lane is at, so lanes that went
+// separate ways on a branch meet again at the first common address.
+void Batch::runTile(const size_t begin, const size_t end) {
+    int32_t pc = lowestPC(begin, end);
+    while (pc != NO_LANE) {
+        size_t leader = begin;
+        while (regs.cycles[leader] <= 0 || regs.PC[leader] != pc) {
+            leader++;
+        }
+        const Byte opcode = memories[leader].readByte(static_cast<Word>(pc));
+        const LaneOp &op = laneOps[opcode];
+
+        if (op.kind == Kind::ADC || op.kind == Kind::SBC) {
+            //Lanes in decimal mode take the interpreter's table path, the rest stay vectorized
+            for (size_t lane = leader; lane < end; lane++) {
+                if (regs.cycles[lane] > 0 && regs.PC[lane] == pc && (regs.P[lane] & FLAG_D) &&
+                    memories[lane].readByte(static_cast<Word>(pc)) == opcode) {
+                    stepLane(lane);
+                    retired++;
+                }
+            }
+        }
+        if (op.kind != Kind::NONE && pc + op.bytes <= 0xFFFF) {
+            pc = stepGroup<Backend>(regs, memories, storage.get() + SLACK, op, opcode, static_cast<Word>(pc),
+                                    begin, end, retired);
+            continue;
+        }
+        for (size_t lane = leader; lane < end; lane++) {
+            if (regs.cycles[lane] > 0 && regs.PC[lane] == pc && memories[lane].readByte(static_cast<Word>(pc)) == opcode) {
+                stepLane(lane);
+                retired++;
+            }
+        }
+        pc = lowestPC(begin, end);
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "CPU.h"
+#include "Memory.h"
+
+// Many CPUs running the same program side by side. Registers are kept as one
+// array per register (structure of arrays) and every round the lanes sitting
+// at the lowest PC execute that instruction together, eight at a time (AVX2
+// when built with EMU_AVX2, plain loops otherwise). Lanes that took another
+// branch simply wait until the lowest PC reaches them again. Opcodes outside
+// the vector subset run lane by lane on the regular interpreter.
+class Batch {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    static constexpr size_t WIDTH = 8;                  //Lanes per vector step
+    static constexpr size_t TILE = 256;                 //Lanes run to the end together, keeps their pages cached
+
+    explicit Batch(size_t lanes);
+    ~Batch();
+
+    Batch(const Batch&) = delete;
+    Batch &operator=(const Batch&) = delete;
+
+    [[nodiscard]] size_t size() const { return lanes; }
+    [[nodiscard]] Memory &memory(const size_t lane) { return memories[lane]; }
+
+    void reset();                                       //Every lane from its own reset vector
+    void execute(int cycles);                           //Same budget for every lane
+
+    [[nodiscard]] Cpu::State state(size_t lane) const;
+    void setState(size_t lane, const Cpu::State &state);
+    [[nodiscard]] uint64_t instructions() const { return retired; }
+
+    // Register file of all lanes, padded to a multiple of WIDTH
+    struct Lanes {
+        std::vector<int32_t> PC, A, X, Y, SP, P;        //P as pushed by PHP
+        std::vector<int32_t> cycles, totalCycles;       //Budget left and cycles spent in this execute()
+        std::vector<int32_t> memoryOffset;              //Pages of each lane, relative to lane 0
+    };
+
+private:
+    static constexpr size_t SLACK = 4;                  //Gathers read the dword ending at a byte
+
+    size_t lanes;
+    Lanes regs;
+    std::unique_ptr<Byte[]> storage;                    //Every lane's 64 KB back to back
+    std::deque<Memory> memories;                        //Pinned onto storage, never relocated
+    std::vector<uint64_t> cycleBase;                    //Cycles before this execute(), the lanes only count the rest
+    std::unique_ptr<Cpu> interpreter;                   //Runs opcodes the vector path does not cover
+    uint64_t retired = 0;
+
+    [[nodiscard]] int32_t lowestPC(size_t begin, size_t end) const; //Lowest PC of a lane with budget left
+    void runTile(size_t begin, size_t end);
+    void stepLane(size_t lane);
+};
+
+#endif //BATCH_H
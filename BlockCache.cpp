@@ -0,0 +1,89 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "BlockCache.h"
+#include <algorithm>
+
+BlockCache::BlockCache(Memory &memory)
+    : mem(&memory), layout(memory.layout()), blockAt(65536, -1) {
+    mem->attachWatcher(this);
+}
+
+BlockCache::~BlockCache() {
+    if (mem) {
+        mem->attachWatcher(nullptr);
+    }
+}
+
+BlockCache::Block &BlockCache::insert(Block &&block) {
+    int32_t index;
+    if (freeBlocks.empty()) {
+        index = static_cast<int32_t>(blocks.size());
+        blocks.push_back(std::move(block));
+    } else {
+        index = freeBlocks.back();
+        freeBlocks.pop_back();
+        blocks[index] = std::move(block);
+    }
+
+    Block &stored = blocks[index];
+    stored.valid = true;
+    blockAt[stored.start] = index;
+
+    const Byte firstPage = stored.start >> 8;
+    const Byte lastPage = static_cast<Word>(stored.start + stored.size - 1) >> 8;
+    for (Byte page = firstPage; ; page++) {
+        pageBlocks[page].push_back(index);
+        if (mem) {
+            mem->watchPage(page, true);
+        }
+        if (page == lastPage) break;
+    }
+    return stored;
+}
+
+void BlockCache::flush() {
+    for (int32_t index = 0; index < static_cast<int32_t>(blocks.size()); index++) {
+        if (blocks[index].valid) {
+            invalidate(index);
+        }
+    }
+    if (mem) {
+        layout = mem->layout();
+    }
+}
+
+void BlockCache::memoryWritten(const uint16_t addr) {
+    // Walk backwards, invalidate() removes entries from this list
+    const std::vector<int32_t> &candidates = pageBlocks[addr >> 8];
+    for (size_t i = candidates.size(); i-- > 0; ) {
+        const int32_t index = candidates[i];
+        const Block &block = blocks[index];
+        if (block.valid && static_cast<Word>(addr - block.start) < block.size) {
+            invalidate(index);
+        }
+    }
+}
+
+void BlockCache::memoryDetached() {
+    mem = nullptr;
+}
+
+void BlockCache::invalidate(const int32_t index) {
+    Block &block = blocks[index];
+    block.valid = false;
+    blockAt[block.start] = -1;
+
+    const Byte firstPage = block.start >> 8;
+    const Byte lastPage = static_cast<Word>(block.start + block.size - 1) >> 8;
+    for (Byte page = firstPage; ; page++) {
+        std::vector<int32_t> &list = pageBlocks[page];
+        list.erase(std::remove(list.begin(), list.end(), index), list.end());
+        if (list.empty() && mem) {
+            mem->watchPage(page, false);
+        }
+        if (page == lastPage) break;
+    }
+    freeBlocks.push_back(index);
+}
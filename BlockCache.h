@@ -0,0 +1,77 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+class Cpu;
+
+// Predecoded basic blocks keyed by their start address. Blocks register the
+// pages they were decoded from, and any write into one of those bytes drops
+// the block so self-modifying code is decoded again. Blocks never cover device
+// pages, and mapping or unmapping a device drops them all.
+class BlockCache final : public MemoryWatcher {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    using Handler = void (Cpu::*)(Memory &memory, int &cycles);
+
+    struct DecodedOp {
+        Handler handler;
+        Word operand;
+        Byte opcode;
+        Byte length;      //Operand bytes
+        Byte cycles;      //Cpu::baseCycles of the opcode
+    };
+
+    struct Block {
+        Word start{};
+        Word size{};      //Bytes of guest code covered
+        bool valid{};
+        std::vector<DecodedOp> ops;
+    };
+
+    static constexpr size_t MAX_BLOCK_OPS = 32;
+
+    explicit BlockCache(Memory &memory);
+    ~BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache &operator=(const BlockCache&) = delete;
+
+    // False once the Memory it watched is gone or detached it
+    [[nodiscard]] bool boundTo(const Memory &memory) const { return mem == &memory; }
+
+    [[nodiscard]] Block* find(const Word pc) {
+        if (layout != mem->layout()) [[unlikely]] {
+            flush(); //RAM the blocks were decoded from may sit under a device now
+        }
+        const int32_t index = blockAt[pc];
+        return index < 0 ? nullptr : &blocks[index];
+    }
+
+    Block &insert(Block &&block);
+    void flush();
+
+    void memoryWritten(uint16_t addr) override;
+    void memoryDetached() override;
+
+private:
+    Memory* mem;                              //Null once detached
+    uint32_t layout = 0;                      //Memory::layout the blocks were decoded against
+    std::vector<int32_t> blockAt;             //Start address -> index into blocks
+    std::vector<Block> blocks;
+    std::vector<int32_t> freeBlocks;
+    std::vector<int32_t> pageBlocks[256];     //Blocks that cover each page
+
+    void invalidate(int32_t index);
+};
+
+#endif //BLOCKCACHE_H
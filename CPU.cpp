@@ -1,9 +1,11 @@
 //
 // Created by P!nk on 30.06.2025.
 //
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 #include "CPU.h"
+#include "Decimal.h"
 #include "Memory.h"
 #include "Emulator.h"
 
@@ -26,87 +28,144 @@ std::string Cpu::toString(const instructionModes mode) {
 Cpu::Byte Cpu::encodeFlags() const {
     Byte status = 0;
 
-    status |= (N << 7);
-    status |= (V << 6);
+    status |= (negative() << 7);
+    status |= (overflow() << 6);
     status |= (1 << 5);            // Unused bit zawsze ustawiony na 1
     status |= (B << 4);
     status |= (D << 3);
     status |= (I << 2);
-    status |= (Z << 1);
-    status |= C;
+    status |= (zero() << 1);
+    status |= carry();
 
     return status;
 }
 
 void Cpu::decodeFlags(const Byte status) {
-    N = (status >> 7) & 1;
-    V = (status >> 6) & 1;
+    negativeSource = status & 0x80;
+    setOverflow((status >> 6) & 1);
     B = (status >> 4) & 1;
     D = (status >> 3) & 1;
     I = (status >> 2) & 1;
-    Z = (status >> 1) & 1;
-    C = status & 1;
+    zeroSource = ~status & 0x02;
+    setCarry(status & 1);
 }
 
 void Cpu::attachEmulator(Emulator *emu) {
     this->emulator = emu;
 }
 
+void Cpu::attachTraceSink(TraceSink *sink) {
+    this->traceSink = sink;
+}
+
+void Cpu::attachProfiler(Profiler *newProfiler) {
+    this->profiler = newProfiler;
+}
+
+void Cpu::attachInterruptListener(InterruptListener *listener) {
+    this->interruptListener = listener;
+}
+
+void Cpu::setEngine(const Engine newEngine) {
+    engine = newEngine;
+    if (engine != Engine::BLOCK_CACHE) {
+        blockCache.reset();
+    }
+    if (engine != Engine::JIT) {
+        jit.reset();
+    }
+}
+
+Cpu::State Cpu::saveState() const {
+    return {PC, A, X, Y, SP, encodeFlags(), totalCycles};
+}
+
+void Cpu::loadState(const State &state) {
+    PC = state.PC;
+    A = state.A; X = state.X; Y = state.Y; SP = state.SP;
+    decodeFlags(state.status);
+    totalCycles = state.totalCycles;
+}
+
 void Cpu::reset(Memory &memory) {
-    PC = memory[0xFFFC] + (memory[0xFFFD] << 8);
+    //Caches bound to another Memory are dropped without touching it, it may be gone
+    if (blockCache && !blockCache->boundTo(memory)) {
+        blockCache.reset();
+    }
+    if (jit && !jit->boundTo(memory)) {
+        jit.reset();
+    }
+    if (blockCache) {
+        blockCache->flush(); //Memory may have been reloaded behind our back
+    }
+    if (jit) {
+        jit->flush();
+    }
+    PC = memory.readByte(0xFFFC) + (memory.readByte(0xFFFD) << 8);
     SP = 0xFF;
+    pendingInterrupts = 0;
     totalCycles = 0;
-    A = X = Y = C = Z = I = D = B = V = 0;
+    retired = 0;
+    A = X = Y = I = D = B = 0;
+    setCarry(false); setOverflow(false);
+    zeroSource = 1;
 }
 
-Cpu::Byte Cpu::fetchByte(int &cycles, Memory &memory) {
-    const Byte value = memory[PC];
-    cycles--; totalCycles++; PC++;
+Cpu::Byte Cpu::fetchByte(Memory &memory) {
+    const Byte value = memory.readByte(PC);
+    PC++;
     return value;
 }
 
-Cpu::Word Cpu::fetchWord(int &cycles, Memory &memory) {
-    const Byte firstByte = fetchByte(cycles, memory);
-    const Byte secondByte = fetchByte(cycles, memory);
+Cpu::Word Cpu::fetchWord(Memory &memory) {
+    const Byte firstByte = fetchByte(memory);
+    const Byte secondByte = fetchByte(memory);
     const Word wholeAddress = (secondByte << 8) | firstByte;
     return wholeAddress;
 }
 
-Cpu::Byte Cpu::readByte(int &cycles, Memory &memory, const Word addr) {
-    const Byte value = memory[addr];
-    cycles--; totalCycles++;
-    return value;
+template<int bytes>
+void Cpu::fetchOperand(Memory &memory) {
+    if constexpr (bytes == 1) {
+        operand = fetchByte(memory);
+    } else if constexpr (bytes == 2) {
+        operand = fetchWord(memory);
+    }
 }
 
-Cpu::Word Cpu::readWord(int &cycles, Memory &memory, const Word addr) {
-    const Byte firstByte = readByte(cycles, memory, addr);
-    const Byte secondByte = readByte(cycles, memory, (addr + 1) & 0x00FF);
+Cpu::Byte Cpu::readByte(Memory &memory, const Word addr) {
+    return memory.readByte(addr);
+}
+
+Cpu::Word Cpu::readWord(Memory &memory, const Word addr) {
+    const Byte firstByte = readByte(memory, addr);
+    const Byte secondByte = readByte(memory, (addr + 1) & 0x00FF);
     const Word wholeAddress = (secondByte << 8) | firstByte;
     return wholeAddress;
 }
 
-void Cpu::writeToStack(int &cycles, Memory &memory, Byte value) {
-    memory[0x0100 + SP] = value;
-    SP--; totalCycles++; cycles--;
+void Cpu::writeToStack(Memory &memory, Byte value) {
+    memory.writeByte(0x0100 + SP, value);
+    SP--;
 }
 
-void Cpu::writeWordToStack(int &cycles, Memory &memory, Word value) {
+void Cpu::writeWordToStack(Memory &memory, Word value) {
     const Byte high = (value >> 8) & 0xFF;
     const Byte low  = value & 0xFF;
 
-    writeToStack(cycles, memory, high);
-    writeToStack(cycles, memory, low);
+    writeToStack(memory, high);
+    writeToStack(memory, low);
 }
 
-Cpu::Byte Cpu::fetchFromStack(int &cycles, Memory &memory) {
-    SP++; totalCycles++; cycles--;
-    return memory[0x0100 + SP];
+Cpu::Byte Cpu::fetchFromStack(Memory &memory) {
+    SP++;
+    return memory.readByte(0x0100 + SP);
 }
 
 
-Cpu::Word Cpu::fetchWordFromStack(int &cycles, Memory &memory) {
-    const Byte high = fetchFromStack(cycles, memory);
-    const Byte low = fetchFromStack(cycles, memory);
+Cpu::Word Cpu::fetchWordFromStack(Memory &memory) {
+    const Byte low = fetchFromStack(memory);
+    const Byte high = fetchFromStack(memory);
     return (high << 8) | low;
 }
 
@@ -114,84 +173,53 @@ void Cpu::branch(int &cycles, const Byte offset) {
     const Word oldPC = PC;
     const auto signedOffset = static_cast<int8_t>(offset);
     PC += signedOffset - 1;
-    cycles--; totalCycles++;
-
-    if ((oldPC & 0xFF00) != (PC & 0xFF00)) {
-        cycles--; totalCycles++;
-    }
-}
-
-Cpu::Byte Cpu::getValueFromZP(int &cycles, Memory &memory, const instructionModes mode) {
-
-    Byte addr = fetchByte(cycles, memory);
-    Byte value = 0;
-    Word wordAddr;
-
-    switch (mode) {
-        case ZP: {
-            value = readByte(cycles, memory, addr);
-            return value;
-        }
-        case ZPX: {
-            addr += X; cycles--; totalCycles++;
-            value = readByte(cycles, memory, addr);
-            return value;
-        }
-        case ZPY: {
-            addr += Y; cycles--; totalCycles++;
-            value = readByte(cycles, memory, addr);
-            return value;
-        }
-        case INDX: {
-            addr += X; cycles--; totalCycles++;
-            wordAddr = readWord(cycles, memory, addr);
-            value = readByte(cycles, memory, wordAddr);
-            return value;
-        }
-        case INDY: {
-            wordAddr = readWord(cycles, memory, addr) + Y;
-            cycles--; totalCycles++;
-            value = readByte(cycles, memory, wordAddr);
-            return value;
-        }
-        default: {
-            Emulator::log(totalCycles, Emulator::ERROR, "Failed to read address from zero page.");
-            return 0xFF;
+    addCycles(cycles, (oldPC & 0xFF00) != (PC & 0xFF00) ? 2 : 1); //Taken, one more into another page
+}
+
+template<Cpu::instructionModes mode>
+Cpu::Byte Cpu::getValueFromZP(int &cycles, Memory &memory) {
+    static_assert(mode == ZP || mode == ZPX || mode == ZPY || mode == INDX || mode == INDY,
+        "Not a zero page addressing mode");
+
+    Byte addr = operand;
+
+    if constexpr (mode == ZP) {
+        return readByte(memory, addr);
+    } else if constexpr (mode == ZPX) {
+        addr += X;
+        return readByte(memory, addr);
+    } else if constexpr (mode == ZPY) {
+        addr += Y;
+        return readByte(memory, addr);
+    } else if constexpr (mode == INDX) {
+        addr += X;
+        const Word wordAddr = readWord(memory, addr);
+        return readByte(memory, wordAddr);
+    } else {
+        const Word baseAddr = readWord(memory, addr);
+        const Word wordAddr = baseAddr + Y;
+        if ((baseAddr & 0xFF00) != (wordAddr & 0xFF00)) {
+            addCycles(cycles, 1); //Another cycle if the value crosses a memory page
         }
+        return readByte(memory, wordAddr);
     }
 }
 
-Cpu::Word Cpu::getValueFromABS(int &cycles, Memory &memory, const instructionModes mode) {
+template<Cpu::instructionModes mode>
+Cpu::Byte Cpu::getValueFromABS(int &cycles, Memory &memory) {
+    static_assert(mode == ABS || mode == ABX || mode == ABY, "Not an absolute addressing mode");
 
-    const Word baseAddr = fetchWord(cycles,memory);
-    Word addr = 0;
-    Word value = 0;
+    const Word baseAddr = operand;
 
-    switch (mode) {
-        case ABS: {
-            value = readByte(cycles, memory, baseAddr);
-            return value;
-        }
-        case ABX: {
-            addr = baseAddr + X;
-            value = readByte(cycles, memory, addr);
-            if ((baseAddr & 0xFF00) != (addr & 0xFF00)) {
-                cycles--; totalCycles++; //Another cycle if the value crosses a memory page
-            }
-            return value;
-        }
-        case ABY: {
-            addr = baseAddr + Y;
-            value = readByte(cycles, memory, addr);
-            if ((baseAddr & 0xFF00) != (addr & 0xFF00)) {
-                cycles--; totalCycles++; //Another cycle if the value crosses a memory page
-            }
-            return value;
-        }
-        default: {
-            Emulator::log(totalCycles, Emulator::ERROR, "Failed to read absolute address value.");
-            return 0xFF;
+    if constexpr (mode == ABS) {
+        return readByte(memory, baseAddr);
+    } else {
+        const Word addr = baseAddr + (mode == ABX ? X : Y);
+        const Byte value = readByte(memory, addr);
+        if ((baseAddr & 0xFF00) != (addr & 0xFF00)) {
+            addCycles(cycles, 1); //Another cycle if the value crosses a memory page
         }
+        return value;
     }
 }
 
@@ -213,11 +241,11 @@ void Cpu::setReg(const registers reg, const Byte value) {
 }
 
 void Cpu::setZ(const Byte value) {
-    Z = (value == 0);
+    zeroSource = value;
 }
 
 void Cpu::setN(const Byte value) {
-    N = (value & 0x80) != 0;
+    negativeSource = value;
 }
 
 Cpu::Byte Cpu::returnReg(const registers reg) const {
@@ -237,9 +265,9 @@ Cpu::Byte Cpu::returnReg(const registers reg) const {
 Cpu::Byte Cpu::returnFlag(const flags flag) const {
     switch (flag) {
         case c:
-            return C;
+            return carry();
         case z:
-            return Z;
+            return zero();
         case i:
             return I;
         case d:
@@ -247,702 +275,632 @@ Cpu::Byte Cpu::returnFlag(const flags flag) const {
         case b:
             return B;
         case v:
-            return V;
+            return overflow();
         case n:
-            return N;
+            return negative();
         default:
             std::cout << "Unknown flag: " << flag << std::endl;
             return 0x00;
     }
 }
 
-void Cpu::execute(int cycles, Memory &memory) {
-    while (cycles > 0) {
-        const Byte instruction = fetchByte(cycles, memory);
+// Without events the engine gets the whole budget. With events it runs in
+// slices that end at the next deadline, and the due events fire in between.
+void Cpu::execute(const int cycles, Memory &memory) {
+    halted = false;
+    if (scheduler.empty()) [[likely]] {
+        runEngine(cycles, memory);
+        published.store(IDLE_SAMPLE, std::memory_order_relaxed);
+        return;
+    }
+    int left = cycles;
+    while (left > 0 && !halted) {
+        const uint64_t start = totalCycles;
+        const uint64_t deadline = scheduler.nextDeadline();
+        if (deadline > start) {
+            runEngine(static_cast<int>(std::min<uint64_t>(left, deadline - start)), memory);
+            left -= static_cast<int>(totalCycles - start);
+        }
+        scheduler.fire(totalCycles);
+    }
+    published.store(IDLE_SAMPLE, std::memory_order_relaxed);
+}
+
+void Cpu::runEngine(const int cycles, Memory &memory) {
+    switch (engine) {
+        case Engine::BLOCK_CACHE:
+            runBlocks<defaultTraceLevel>(cycles, memory); break;
+        case Engine::JIT:
+            runJit<defaultTraceLevel>(cycles, memory); break;
+        default:
+            run<defaultTraceLevel>(cycles, memory); break;
+    }
+}
+
+template<TraceLevel trace>
+void Cpu::traceInstruction(const Word pc, const Byte instruction) {
+    if constexpr (trace == TraceLevel::TEXT) {
         std::cout << "\nCykl: " << totalCycles
             << ", Instrukcja: " << static_cast<int>(instruction);
-            // << "\nRegister A = " << static_cast<int>(A)
-            // << "\nRegister X = " <<  static_cast<int>(X)
-            // << "\nRegister Y = " << static_cast<int>(Y) << "\n";
-        switch (instruction) {
-            case 0x69: //ADC Immediate
-                ADC(IM, memory, cycles); break;
-            case 0x65: //ADC Zero Page
-                ADC(ZP, memory, cycles); break;
-            case 0x75: //ADC Zero Page,X
-                ADC(ZPX, memory, cycles); break;
-            case 0x6D: // ADC Absolute
-                ADC(ABS, memory, cycles); break;
-            case 0x7D: // ADC Absolute,X
-                ADC(ABX, memory, cycles); break;
-            case 0x79: // ADC Absolute,Y
-                ADC(ABY, memory, cycles); break;
-            case 0x61: //ADC (Indirect,X)
-                ADC(INDX, memory, cycles); break;
-            case 0x71: //ADC (Indirect),Y
-                ADC(INDY, memory, cycles); break;
-            case 0xE9: //SBC
-                SBC(IM, memory, cycles); break;
-            case 0xE5: //SBC Zero Page
-                SBC(ZP, memory, cycles); break;
-            case 0xF5: //SBC Zero Page,X
-                SBC(ZPX, memory, cycles); break;
-            case 0xED: //SBC Absolute
-                SBC(ABS, memory, cycles); break;
-            case 0xFD: //SBC Absolute,X
-                SBC(ABX, memory, cycles); break;
-            case 0xF9: //SBC Absolute,Y
-                SBC(ABY, memory, cycles); break;
-            case 0xE1: //SBC (Indirect,X)
-                SBC(INDX, memory, cycles); break;
-            case 0xF1: //SBC (Indirect),Y
-                SBC(INDY, memory, cycles); break;
-            case 0x29: //AND Immediate
-                AND(IM, memory, cycles); break;
-            case 0x25: //AND Zero Page
-                AND(ZP, memory, cycles); break;
-            case 0x35: //AND Zero Page,X
-                AND(ZPX, memory, cycles); break;
-            case 0x2D: //AND Absolute
-                AND(ABS, memory, cycles); break;
-            case 0x3D: //AND Absolute,X
-                AND(ABX, memory, cycles); break;
-            case 0x39: //AND Absolute,Y
-                AND(ABY, memory, cycles); break;
-            case 0x21: //AND (Indirect,X)
-                AND(INDX, memory, cycles); break;
-            case 0x31: //AND (Indirect),Y
-                AND(INDY, memory, cycles); break;
-            case 0xA9: //LDA Immediate
-                LDA(IM, memory, cycles); break;
-            case 0xA5: //LDA Zero Page
-                LDA(ZP, memory, cycles); break;
-            case 0xB5: //LDA Zero Page,X
-                LDA(ZPX, memory, cycles); break;
-            case 0xAD: //LDA Absolute
-                LDA(ABS, memory, cycles); break;
-            case 0xBD: //LDA Absolute,X
-                LDA(ABX, memory, cycles); break;
-            case 0xB9: //LDA Absolute,Y
-                LDA(ABY, memory, cycles); break;
-            case 0xA1: //LDA (Indirect,X)
-                LDA(INDX, memory, cycles); break;
-            case 0xB1: //LDA (Indirect),Y
-                LDA(INDY, memory, cycles); break;
-            case 0xA2: //LDX Immediate
-                LDX(IM, memory, cycles); break;
-            case 0xA6: //LDX Zero Page
-                LDX(ZP, memory, cycles); break;
-            case 0xB6: //LDX Zero Page,Y
-                LDX(ZPY, memory, cycles); break;
-            case 0xAE: //LDX Absolute
-                LDX(ABS, memory, cycles); break;
-            case 0xBE: //LDX Absolute,Y
-                LDX(ABY, memory, cycles); break;
-            case 0xA0: //LDY Immediate
-                LDY(IM, memory, cycles); break;
-            case 0xA4: //LDY Zero Page
-                LDY(ZP, memory, cycles); break;
-            case 0xB4: //LDY Zero Page,X
-                LDY(ZPX, memory, cycles); break;
-            case 0xAC: //LDY Absolute
-                LDY(ABS, memory, cycles); break;
-            case 0xBC: //LDY Absolute,X
-                LDY(ABX, memory, cycles); break;
-            case 0x85: //STA Zero Page
-                STA(ZP, memory, cycles); break;
-            case 0x95: //STA Zero Page,X
-                STA(ZPX, memory, cycles); break;
-            case 0x8D: //STA Absolute
-                STA(ABS, memory, cycles); break;
-            case 0x9D: //STA Absolute,X
-                STA(ABX, memory, cycles); break;
-            case 0x99: //STA Absolute,Y
-                STA(ABY, memory, cycles); break;
-            case 0x81: //STA (Indirect,X)
-                STA(INDX, memory, cycles); break;
-            case 0x91: //STA (Indirect), Y
-                STA(INDY, memory, cycles); break;
-            case 0x86: //STX Zero Page
-                STX(ZP, memory, cycles); break;
-            case 0x96: //STX Zero Page,Y
-                STX(ZPY, memory, cycles); break;
-            case 0x8E: //STX Absolute
-                STX(ABS, memory, cycles); break;
-            case 0x84: //STY Zero Page
-                STY(ZP, memory, cycles); break;
-            case 0x94: //STY Zero Page,X
-                STY(ZPX, memory, cycles); break;
-            case 0x8C: //STY Absolute
-                STY(ABS, memory, cycles); break;
-            case 0x4C: //JMP Absolute
-                JMP(ABS, memory, cycles); break;
-            case 0x6C: //JMP Indirect
-                JMP(IN, memory, cycles); break;
-            case 0xEA: //NOP
-                cycles--; totalCycles++; break;
-            case 0x78: //SEI
-                SEI(memory, cycles);  break;
-            case 0xF8: //SED
-                SED(memory, cycles); break;
-            case 0x38: //SEC
-                SEC(memory, cycles); break;
-            case 0x18: //CLC
-                CLC(memory, cycles); break;
-            case 0xD8: //CLD
-                CLD(memory, cycles); break;
-            case 0x58: //CLI
-                CLI(memory, cycles); break;
-            case 0xB8: //CLV
-                CLV(memory, cycles); break;
-            case 0xAA: //TAX
-                TAX(memory, cycles); break;
-            case 0xA8: //TAY
-                TAY(memory, cycles); break;
-            case 0x8A: //TXA
-                TXA(memory, cycles); break;
-            case 0x98: //TYA
-                TYA(memory, cycles); break;
-            case 0xE6: //INC Zero Page
-                INC(ZP, memory, cycles); break;
-            case 0xF6: //INC ZeroPage,X
-                INC(ZPX, memory, cycles); break;
-            case 0xEE: //INC Absolute
-                INC(ABS, memory, cycles); break;
-            case 0xFE: //INC Absolute,X
-                INC(ABX, memory, cycles); break;
-            case 0xE8: //INX
-                INX(memory, cycles); break;
-            case 0xC8: //INY
-                INY(memory, cycles); break;
-            case 0xC6: //DEX Zero Page
-                DEC(ZP, memory, cycles); break;
-            case 0xD6: //DEX Zero Page,X
-                DEC(ZPX, memory, cycles); break;
-            case 0xCE: //DEX Absolute
-                DEC(ABS, memory, cycles); break;
-            case 0xDE: //DEX Absolute,X
-                DEC(ABX, memory, cycles); break;
-            case 0xCA: //DEX
-                DEX(memory, cycles); break;
-            case 0x88: //DEY
-                DEY(memory, cycles); break;
-            case 0x49: //EOR
-                EOR(IM, memory, cycles); break;
-            case 0x45: //EOR Zero Page
-                EOR(ZP, memory, cycles); break;
-            case 0x55: //EOR Zero Page,X
-                EOR(ZPX, memory, cycles); break;
-            case 0x4D: //EOR Absolute
-                EOR(ABS, memory, cycles); break;
-            case 0x5D: //EOR Absolute,X
-                EOR(ABX, memory, cycles); break;
-            case 0x59: //EOR Absolute,Y
-                EOR(ABY, memory, cycles); break;
-            case 0x41: //EOR (Indirect,X)
-                EOR(INDX, memory, cycles); break;
-            case 0x51: //EOR (Indirect),Y
-                EOR(INDY, memory, cycles); break;
-            case 0x09: //ORA
-                ORA(IM, memory, cycles); break;
-            case 0x05: //ORA Zero Page
-                ORA(ZP, memory, cycles); break;
-            case 0x15: //ORA Zero Page,X
-                ORA(ZPX, memory, cycles); break;
-            case 0x0D: //ORA Absolute
-                ORA(ABS, memory, cycles); break;
-            case 0x1D: //ORA Absolute,X
-                ORA(ABX, memory, cycles); break;
-            case 0x19: //ORA Absolute,Y
-                ORA(ABY, memory, cycles); break;
-            case 0x01: //ORA (Indirect,X)
-                ORA(INDX, memory, cycles); break;
-            case 0x11: //ORA (Indirect),Y
-                ORA(INDY, memory, cycles); break;
-            case 0x70: //BVS
-                BVS(memory, cycles); break;
-            case 0x50: //BVC
-                BVC(memory, cycles); break;
-            case 0x10: //BPL
-                BPL(memory, cycles); break;
-            case 0xD0: //BNE
-                BNE(memory, cycles); break;
-            case 0x30: //BMI
-                BMI(memory, cycles); break;
-            case 0xF0: //BEQ
-                BEQ(memory, cycles); break;
-            case 0xB0: //BCS
-                BCS(memory, cycles); break;
-            case 0x90: //BCC
-                BCC(memory, cycles); break;
-            case 0xC9: //CMP
-                CMP(IM, memory, cycles); break;
-            case 0xC5: //CMP Zero Page
-                CMP(ZP, memory, cycles); break;
-            case 0xD5: //CMP Zero Page,X
-                CMP(ZPX, memory, cycles); break;
-            case 0xCD: //CMP Absolute
-                CMP(ABS, memory, cycles); break;
-            case 0xDD: //CMP Absolute,X
-                CMP(ABX, memory, cycles); break;
-            case 0xD9: //CMP Absolute,Y
-                CMP(ABY, memory, cycles); break;
-            case 0xC1: //CMP (Indirect,X)
-                CMP(INDX, memory, cycles); break;
-            case 0xD1: //CMP (Indirect),Y
-                CMP(INDY, memory, cycles); break;
-            case 0x48: //PHA
-                PHA(memory, cycles); break;
-            case 0x08: //PHP
-                PHP(memory, cycles); break;
-            case 0x68: //PLA
-                PLA(memory, cycles); break;
-            case 0x28: //PLP
-                PLP(memory, cycles); break;
-            case 0xBA: //TSX
-                TSX(memory, cycles); break;
-            case 0x9A: //TXS
-                TXS(memory, cycles); break;
-            case 0x2A: //ROL Accumulator
-                ROL(ACC, memory, cycles); break;
-            case 0x26: //ROL Zero Page
-                ROL(ZP, memory, cycles); break;
-            case 0x36: //ROL Zero Page,X
-                ROL(ZPX, memory, cycles); break;
-            case 0x2E: //ROL Absolute
-                ROL(ABS, memory, cycles); break;
-            case 0x3E: //ROL Absolute,X
-                ROL(ABX, memory, cycles); break;
-            case 0x6A: //ROR Accumulator
-                ROR(ACC, memory, cycles); break;
-            case 0x66: //ROR Zero Page
-                ROR(ZP, memory, cycles); break;
-            case 0x76: //ROR Zero Page,X
-                ROR(ZPX, memory, cycles); break;
-            case 0x6E: //ROR Absolute
-                ROR(ABS, memory, cycles); break;
-            case 0x7E: //ROR Absolute,X
-                ROR(ABX, memory, cycles); break;
-            case 0xE0: //CPX
-                CPX(IM, memory, cycles); break;
-            case 0xE4: //CPX Zero Page
-                CPX(ZP, memory, cycles); break;
-            case 0xEC: //CPX Absolute
-                CPX(ABS, memory, cycles); break;
-            case 0xC0: //CPY
-                CPY(IM, memory, cycles); break;
-            case 0xC4: //CPY Zero Page
-                CPY(ZP, memory, cycles); break;
-            case 0xCC: //CPY Absolute
-                CPY(ABS, memory, cycles); break;
-            case 0x20: //JSR
-                JSR(memory, cycles); break;
-            case 0x60: //RTS
-                RTS(memory, cycles); break;
-            case 0x00: //BRK
-                BRK(memory, cycles); break;
-            case 0x40: //RTI
-                RTI(memory, cycles); break;
-            case 0x24: //BIT Zero Page
-                BIT(ZP, memory, cycles); break;
-            case 0x2C: //BIT Absolute
-                BIT(ABS, memory, cycles); break;
-            case 0x4A: //LSR Accumulator
-                LSR(ACC, memory, cycles); break;
-            case 0x46: //LSR Zero Page
-                LSR(ZP, memory, cycles); break;
-            case 0x56: //LSR Zero Page,X
-                LSR(ZPX, memory, cycles); break;
-            case 0x4E: //LSR Absolute
-                LSR(ABS, memory, cycles); break;
-            case 0x5E: //LSR Absolute,X
-                LSR(ABX, memory, cycles); break;
-            case 0x0A: //ASL Accumulator
-                ASL(ACC, memory, cycles); break;
-            case 0x06: //ASL Zero Page
-                ASL(ZP, memory, cycles); break;
-            case 0x16: //ASL Zero Page,X
-                ASL(ZPX, memory, cycles); break;
-            case 0x0E: //ASL Absolute
-                ASL(ABS, memory, cycles); break;
-            case 0x1E: //ASL Absolute,X
-                ASL(ABX, memory, cycles); break;
-            case 0xFF: // CUSTOM OPCODE - Halt CPU.
-                std::cout << "\nHalting CPU - encountered 0xFF";
-                cycles = 0;
-                break;
-            default:
-                Emulator::log(totalCycles, Emulator::ERROR, "Unknown instruction: ", instruction);
-                break;
+    } else if constexpr (trace == TraceLevel::BINARY) {
+        if (traceSink) {
+            traceSink->record({pc, instruction, operand, A, X, Y, SP, encodeFlags(), totalCycles});
         }
     }
 }
 
-Cpu::Word Cpu::getAddress(int &cycles, Memory &memory, const instructionModes mode, const std::string& instruction) {
+template<TraceLevel trace>
+void Cpu::step(int &cycles, Memory &memory) {
+    publish(memory);
+    const Word pc = PC;
+    const uint64_t start = totalCycles;
+    const Byte instruction = fetchByte(memory);
+    addCycles(cycles, baseCycles[instruction]);
+    switch (operandBytes[instruction]) {
+        case 1: fetchOperand<1>(memory); break;
+        case 2: fetchOperand<2>(memory); break;
+        default: break;
+    }
+    traceInstruction<trace>(pc, instruction);
+    (this->*opcodeTable[instruction])(memory, cycles);
+    retired++;
+    profileInstruction(pc, instruction, start);
+}
+
+#if defined(EMU_THREADED_DISPATCH) && defined(__GNUC__)
+
+// Direct threading: every handler ends with its own copy of the dispatch,
+// so the host branch predictor sees one indirect jump per guest opcode.
+template<TraceLevel trace>
+void Cpu::run(int cycles, Memory &memory) {
+    static void* const dispatchTable[256] = {
+#define OPCODE(code, handler, bytes, base) &&op_##code,
+#include "Opcodes.def"
+#undef OPCODE
+    };
+    Word pc;
+    uint64_t start;
+
+#define DISPATCH()                                  \
+    if (cycles <= 0) return;                        \
+    if (pendingInterrupts) [[unlikely]] {           \
+        interrupt(cycles, memory);                  \
+    }                                               \
+    publish(memory);                                \
+    pc = PC;                                        \
+    start = totalCycles;                            \
+    goto *dispatchTable[fetchByte(memory)]
+
+    DISPATCH();
+
+#define OPCODE(code, handler, bytes, base)          \
+    op_##code:                                      \
+    addCycles(cycles, base);                        \
+    fetchOperand<bytes>(memory);                    \
+    traceInstruction<trace>(pc, code);              \
+    handler(memory, cycles);                        \
+    retired++;                                      \
+    profileInstruction(pc, code, start);            \
+    DISPATCH();
+#include "Opcodes.def"
+#undef OPCODE
+#undef DISPATCH
+}
+
+#else
+
+template<TraceLevel trace>
+void Cpu::run(int cycles, Memory &memory) {
+    while (cycles > 0) {
+        if (pendingInterrupts) [[unlikely]] {
+            interrupt(cycles, memory);
+        }
+        step<trace>(cycles, memory);
+    }
+}
 
-    Word address = 0x00;
+#endif
 
-    switch (mode) {
-        case ZP: {
-            address = fetchByte(cycles, memory);
-            return address;
-        }
-        case ZPX: {
-            address = fetchByte(cycles, memory) + X;
-            cycles--; totalCycles++;
-            return address;
+namespace {
+    // Opcodes after which the next PC is not simply the following instruction
+    constexpr bool endsBlock(const unsigned char opcode) {
+        switch (opcode) {
+            case 0x10: case 0x30: case 0x50: case 0x70: //BPL BMI BVC BVS
+            case 0x90: case 0xB0: case 0xD0: case 0xF0: //BCC BCS BNE BEQ
+            case 0x4C: case 0x6C: case 0x20: case 0x60: //JMP JMP JSR RTS
+            case 0x00: case 0x40: case 0xFF:            //BRK RTI HLT
+                return true;
+            default:
+                return false;
         }
-        case ZPY: {
-            address = fetchByte(cycles, memory) + Y;
-            cycles--; totalCycles++;
-            return address;
+    }
+}
+
+BlockCache::Block* Cpu::decodeBlock(const Word pc, Memory &memory) {
+    BlockCache::Block block;
+    block.start = pc;
+
+    Byte* const* pages = memory.pageTable();
+    Word addr = pc;
+    while (block.ops.size() < BlockCache::MAX_BLOCK_OPS && pages[addr >> 8]) {
+        const Byte opcode = memory.readByte(addr);
+        const Byte length = operandBytes[opcode];
+        if (!pages[static_cast<Word>(addr + length) >> 8]) {
+            break; //Code on device pages is fetched by the interpreter, reading it here would run the handler
         }
-        case ABS: {
-            address = fetchWord(cycles, memory);
-            return address;
+        Word value = 0;
+        if (length == 1) {
+            value = memory.readByte(static_cast<Word>(addr + 1));
+        } else if (length == 2) {
+            value = memory.readByte(static_cast<Word>(addr + 1)) | (memory.readByte(static_cast<Word>(addr + 2)) << 8);
         }
-        case ABX: {
-            address = fetchWord(cycles, memory) + X;
-            cycles--; totalCycles++;
-            return address;
+        block.ops.push_back({opcodeTable[opcode], value, opcode, length, baseCycles[opcode]});
+        addr += 1 + length;
+
+        if (endsBlock(opcode) || opcodeTable[opcode] == &Cpu::ILL || addr < pc) {
+            break; //Control flow leaves the block, or the block would wrap around memory
         }
-        case ABY: {
-            address = fetchWord(cycles, memory) + Y;
-            cycles--; totalCycles++;
-            return address;
+    }
+    if (block.ops.empty()) {
+        return nullptr;
+    }
+    block.size = addr - pc;
+    return &blockCache->insert(std::move(block));
+}
+
+// Runs whole predecoded blocks per lookup. Operand bytes are not fetched again
+// and each op carries its base cycles. The budget is still checked per
+// instruction, and a write into the running block (self-modifying code) ends it.
+template<TraceLevel trace>
+void Cpu::runBlocks(int cycles, Memory &memory) {
+    if (!blockCache || !blockCache->boundTo(memory)) {
+        blockCache = std::make_unique<BlockCache>(memory);
+    }
+
+    while (cycles > 0) {
+        if (pendingInterrupts) [[unlikely]] {
+            interrupt(cycles, memory);
         }
-        case INDX: {
-            address = fetchByte(cycles, memory) + X;
-            cycles--; totalCycles++;
-            address = readWord(cycles, memory, address);
-            return address;
+        BlockCache::Block* block = blockCache->find(PC);
+        if (!block) {
+            block = decodeBlock(PC, memory);
         }
-        case INDY: {
-            address = fetchByte(cycles, memory);
-            address = readWord(cycles, memory, address) + Y;
-            return address;
+        if (!block) [[unlikely]] {
+            step<trace>(cycles, memory); //PC is on a device page
+            continue;
         }
-        case IN: {
-            address = fetchWord(cycles, memory);
-            Word indirectAddr;
-            if ((address & 0x00FF) == 0x00FF) {
-                // 6502 Bug - Page boundary wrap around
-                const Byte low = memory[address];
-                const Byte high = memory[address & 0xFF00];
-                indirectAddr = (high << 8) | low;
-            } else {
-                indirectAddr = readWord(cycles, memory, address);
+
+        publish(memory);
+        for (const BlockCache::DecodedOp &op : block->ops) {
+            const Word pc = PC;
+            const uint64_t start = totalCycles;
+            PC += 1 + op.length;
+            addCycles(cycles, op.cycles);
+            operand = op.operand;
+            traceInstruction<trace>(pc, op.opcode);
+            (this->*op.handler)(memory, cycles);
+            retired++;
+            profileInstruction(pc, op.opcode, start);
+
+            if (cycles <= 0 || !block->valid || interruptDue()) {
+                break;
             }
-            return indirectAddr;
-        }
-        default: {
-            Emulator::log(totalCycles, Emulator::ERROR, "Illegal instruction: " + static_cast<std::string>(instruction));
-            return 0x00;
         }
     }
 }
 
-Cpu::Word Cpu::getValueFromAddress(int &cycles, Memory &memory, const instructionModes mode, const std::string &instruction) {
-
-    Word value = 0x00;
+void Cpu::runNative(Jit::Block &block, int &cycles, Memory &memory) {
+#ifdef EMU_JIT_VERIFY
+    const State before = saveState();
+    const auto shadow = std::make_unique<Memory>(memory); //Forked, pages are copied as they are written
+#endif
+    publish(memory);
+    Jit::Context context{};
+    context.A = A; context.X = X; context.Y = Y;
+    context.P = encodeFlags();
+    jit->run(block, context);
+
+    A = context.A; X = context.X; Y = context.Y;
+    decodeFlags(context.P);
+    PC = context.pc;
+    addCycles(cycles, static_cast<int>(context.cycles));
+    retired += context.instructions;
+
+#ifdef EMU_JIT_VERIFY
+    // Replay the same instructions on the interpreter and a copy of memory
+    const State native = saveState();
+    const uint64_t nativeRetired = retired;
+    loadState(before);
+    int shadowCycles = 0;
+    for (uint32_t n = 0; n < context.instructions; n++) {
+        step<TraceLevel::OFF>(shadowCycles, *shadow);
+    }
+    const State interpreted = saveState();
+    loadState(native);
+    retired = nativeRetired;
+    bool sameMemory = true;
+    for (uint32_t addr = 0; addr < 0x10000; addr++) {
+        sameMemory &= shadow->readByte(static_cast<Word>(addr)) == memory.readByte(static_cast<Word>(addr));
+    }
+    if (!(native == interpreted) || !sameMemory) {
+        Emulator::log(totalCycles, Emulator::ERROR, "JIT diverged from the interpreter in block at: ", block.start);
+    }
+#endif
+}
 
-    switch (mode) {
-        case IM:
-            value = fetchByte(cycles, memory);
-            return value;
-        case ZP: {
-            value = getValueFromZP(cycles, memory, ZP);
-            return value;
-        }
-        case ZPX: {
-            value = getValueFromZP(cycles, memory, ZPX);
-            return value;
-        }
-        case ZPY: {
-            value = getValueFromZP(cycles, memory, ZPY);
-            return value;
-        }
-        case ABS: {
-            value = getValueFromABS(cycles, memory, ABS);
-            return value;
-        }
-        case ABX: {
-            value = getValueFromABS(cycles, memory, ABX);
-            return value;
-        }
-        case ABY: {
-            value = getValueFromABS(cycles, memory, ABY);
-            return value;
+// Interprets as usual, but once an address has been entered often enough the
+// block starting there is compiled and later entries run natively. A native
+// block always runs to its end, so it is only entered when the budget would
+// have let the interpreter reach its last instruction as well.
+template<TraceLevel trace>
+void Cpu::runJit(int cycles, Memory &memory) {
+    if constexpr (trace != TraceLevel::OFF || profilingEnabled) {
+        run<trace>(cycles, memory); //Native code has no per-instruction hook
+    } else {
+        if (!Jit::available()) {
+            run<trace>(cycles, memory);
+            return;
         }
-        case IN: {
-            value = readWord(cycles, memory, getValueFromABS(cycles, memory, ABS));
-            return value;
+        if (!jit || !jit->boundTo(memory)) {
+            jit = std::make_unique<Jit>(memory);
         }
-        case INDX: {
-            value = getValueFromZP(cycles, memory, INDX);
-            return value;
+
+        while (cycles > 0) {
+            if (pendingInterrupts) [[unlikely]] {
+                interrupt(cycles, memory); //Native blocks take pending requests once they exit
+            }
+            Jit::Block* block = jit->find(PC);
+            if (!block && jit->isHot(PC)) {
+                block = jit->compile(PC);
+            }
+            if (block && cycles > block->cyclesBeforeLast) {
+                runNative(*block, cycles, memory);
+            } else {
+                step<trace>(cycles, memory);
+            }
         }
-        case INDY: {
-            value = getValueFromZP(cycles, memory, INDY);
-            return value;
+    }
+}
+
+template void Cpu::run<TraceLevel::OFF>(int cycles, Memory &memory);
+template void Cpu::run<TraceLevel::TEXT>(int cycles, Memory &memory);
+template void Cpu::run<TraceLevel::BINARY>(int cycles, Memory &memory);
+template void Cpu::runBlocks<TraceLevel::OFF>(int cycles, Memory &memory);
+template void Cpu::runBlocks<TraceLevel::TEXT>(int cycles, Memory &memory);
+template void Cpu::runBlocks<TraceLevel::BINARY>(int cycles, Memory &memory);
+template void Cpu::runJit<TraceLevel::OFF>(int cycles, Memory &memory);
+template void Cpu::runJit<TraceLevel::TEXT>(int cycles, Memory &memory);
+template void Cpu::runJit<TraceLevel::BINARY>(int cycles, Memory &memory);
+template void Cpu::step<TraceLevel::OFF>(int &cycles, Memory &memory); //Batch steps lanes through it
+
+template<Cpu::instructionModes mode>
+Cpu::Word Cpu::getAddress(Memory &memory) {
+
+    Word address = 0x00;
+
+    if constexpr (mode == ZP) {
+        address = operand;
+    } else if constexpr (mode == ZPX) {
+        address = operand + X;
+    } else if constexpr (mode == ZPY) {
+        address = operand + Y;
+    } else if constexpr (mode == ABS) {
+        address = operand;
+    } else if constexpr (mode == ABX) {
+        address = operand + X;
+    } else if constexpr (mode == ABY) {
+        address = operand + Y;
+    } else if constexpr (mode == INDX) {
+        address = operand + X;
+        address = readWord(memory, address);
+    } else if constexpr (mode == INDY) {
+        address = readWord(memory, operand) + Y;
+    } else if constexpr (mode == IN) {
+        address = operand;
+        if ((address & 0x00FF) == 0x00FF) {
+            // 6502 Bug - Page boundary wrap around
+            const Byte low = memory.readByte(address);
+            const Byte high = memory.readByte(address & 0xFF00);
+            address = (high << 8) | low;
+        } else {
+            address = readWord(memory, address);
         }
-        default:
-            Emulator::log(totalCycles, Emulator::ERROR, "Illegal instruction", instruction );
-            return 0x00;
+    } else {
+        static_assert(mode != mode, "Addressing mode has no effective address");
     }
+    return address;
 }
 
-void Cpu::ADC(const instructionModes mode, Memory &memory, int &cycles) {
-    const Byte value = getValueFromAddress(cycles, memory, mode, "ADC");
-    const Word sum = static_cast<uint16_t>(A) + static_cast<uint16_t>(value) + static_cast<uint16_t>(C);
+template<Cpu::instructionModes mode>
+Cpu::Byte Cpu::getValueFromAddress(int &cycles, Memory &memory) {
+    if constexpr (mode == IM) {
+        return operand;
+    } else if constexpr (mode == ABS || mode == ABX || mode == ABY) {
+        return getValueFromABS<mode>(cycles, memory);
+    } else {
+        return getValueFromZP<mode>(cycles, memory);
+    }
+}
+
+template<Cpu::instructionModes mode>
+void Cpu::ADC(Memory &memory, int &cycles) {
+    const Byte value = getValueFromAddress<mode>(cycles, memory);
+    const Word sum = static_cast<uint16_t>(A) + static_cast<uint16_t>(value) + carry();
+    if (D) [[unlikely]] {
+        //Z still comes from the binary sum, N and V from the decimal one before its last adjust
+        const Word decimal = Decimal::add(A, value, carry());
+        carrySource = decimal & 0x100;
+        overflowLeft = A; overflowRight = value; overflowResult = decimal >> 8;
+        setReg(a, static_cast<Byte>(decimal));
+        setZ(static_cast<Byte>(sum));
+        setN(decimal >> 8);
+        return;
+    }
     const Byte result = static_cast<Byte>(sum & 0xFF);
 
-    C = sum > 0xFF;  // Carry
-    V = (~(A ^ value) & (A ^ result) & 0x80) != 0;  // Overflow
+    carrySource = sum;
+    overflowLeft = A; overflowRight = value; overflowResult = result;
 
     setReg(a, result);
     setZ(result);
     setN(result);
 }
 
-void Cpu::SBC(const instructionModes mode, Memory &memory, int &cycles) {
-    const Byte value = getValueFromAddress(cycles, memory, mode, "SBC");
-    const uint16_t result = static_cast<uint16_t>(A) - static_cast<uint16_t>(value) - (1 - C);
-    const Byte final = result & 0xFF;
+template<Cpu::instructionModes mode>
+void Cpu::SBC(Memory &memory, int &cycles) {
+    const Byte value = getValueFromAddress<mode>(cycles, memory);
+    //A - value - borrow is A + ~value + carry, which leaves the carry in bit 8
+    const Word sum = static_cast<uint16_t>(A) + static_cast<Byte>(~value) + carry();
+    const Byte final = sum & 0xFF;
+    Byte result = final;
+    if (D) [[unlikely]] {
+        result = Decimal::subtract(A, value, carry()); //Only the result, the flags are the binary ones
+    }
 
-    C = result < 0x100;
-    V = ((A ^ value) & (A ^ final) & 0x80) != 0;
+    carrySource = sum;
+    overflowLeft = A; overflowRight = ~value; overflowResult = final;
 
-    setReg(a, final);
+    setReg(a, result);
     setZ(final);
     setN(final);
 }
 
 void Cpu::INY(Memory &memory, int &cycles) {
-    Y++; cycles--; totalCycles++;
+    Y++;
     setN(Y);
     setZ(Y);
 }
 
 void Cpu::INX(Memory &memory, int &cycles) {
-    X++; cycles++; totalCycles++;
+    X++;
     setN(X);
     setZ(X);
 }
 
 void Cpu::DEY(Memory &memory, int &cycles) {
-    Y--; cycles--; totalCycles++;
+    Y--;
     setN(Y);
     setZ(Y);
 }
 
 void Cpu::DEX(Memory &memory, int &cycles) {
-    X--; cycles++; totalCycles++;
+    X--;
     setN(X);
     setZ(X);
 }
 
-void Cpu::INC(const instructionModes mode, Memory &memory, int &cycles) {
-    Word addr = getAddress(cycles, memory, mode, "INC");
-    memory[addr]++; cycles--; totalCycles++;
+template<Cpu::instructionModes mode>
+void Cpu::INC(Memory &memory, int &cycles) {
+    Word addr = getAddress<mode>(memory);
+    memory.writeByte(addr, memory.readByte(addr) + 1);
 }
 
-void Cpu::DEC(const instructionModes mode, Memory &memory, int &cycles) {
-    Word addr = getAddress(cycles, memory, mode, "DEC");
-    memory[addr]--; cycles--; totalCycles++;
+template<Cpu::instructionModes mode>
+void Cpu::DEC(Memory &memory, int &cycles) {
+    Word addr = getAddress<mode>(memory);
+    memory.writeByte(addr, memory.readByte(addr) - 1);
 }
 
-void Cpu::AND(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "AND");
+template<Cpu::instructionModes mode>
+void Cpu::AND(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     Byte result = value & A;
     setReg(a, result);
     setZ(result);
     setN(result);
 }
 
-void Cpu::EOR(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "EOR");
+template<Cpu::instructionModes mode>
+void Cpu::EOR(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     Byte result = value ^ A;
     setReg(a, result);
     setZ(result);
     setN(result);
 }
 
-void Cpu::ORA(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "ORA");
+template<Cpu::instructionModes mode>
+void Cpu::ORA(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     Byte result = value | A;
     setReg(a, result);
     setZ(result);
     setN(result);
 }
 
-void Cpu::CMP(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "CMP");
-    Word sum = static_cast<uint16_t>(A) - static_cast<uint16_t>(value);
+template<Cpu::instructionModes mode>
+void Cpu::CMP(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
+    Word sum = static_cast<uint16_t>(A) + static_cast<Byte>(~value) + 1; //Bit 8 set when A >= value
     Byte result = static_cast<Byte>(sum & 0xFF);
 
-    C = A >= value;
-    Z = A == value;
+    carrySource = sum;
+    setZ(result);
     setN(result);
 }
 
-void Cpu::LDX(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "LDX");
+template<Cpu::instructionModes mode>
+void Cpu::LDX(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     setReg(x, value);
     setZ(value);
     setN(value);
 }
 
-void Cpu::LDY(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "LDY");
+template<Cpu::instructionModes mode>
+void Cpu::LDY(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     setReg(y, value);
     setZ(value);
     setN(value);
 }
 
-void Cpu::LDA(const instructionModes mode, Memory &memory, int &cycles) {
-    Byte value = getValueFromAddress(cycles, memory, mode, "LDA");
+template<Cpu::instructionModes mode>
+void Cpu::LDA(Memory &memory, int &cycles) {
+    Byte value = getValueFromAddress<mode>(cycles, memory);
     setReg(a, value);
     setZ(value);
     setN(value);
 }
 
-void Cpu::STX(const instructionModes mode, Memory &memory, int &cycles) {
-    Word address = getAddress(cycles, memory, mode, "STX");
+template<Cpu::instructionModes mode>
+void Cpu::STX(Memory &memory, int &cycles) {
+    Word address = getAddress<mode>(memory);
     memory.writeByte(address, X);
 }
 
-void Cpu::STY(const instructionModes mode, Memory &memory, int &cycles) {
-    Word address = getAddress(cycles, memory, mode, "STY");
+template<Cpu::instructionModes mode>
+void Cpu::STY(Memory &memory, int &cycles) {
+    Word address = getAddress<mode>(memory);
     memory.writeByte(address, Y);
 }
 
-void Cpu::STA(const instructionModes mode, Memory &memory, int &cycles) {
-    Word address = getAddress(cycles, memory, mode, "STA");
+template<Cpu::instructionModes mode>
+void Cpu::STA(Memory &memory, int &cycles) {
+    Word address = getAddress<mode>(memory);
     memory.writeByte(address, A);
 }
 
-void Cpu::JMP(const instructionModes mode, Memory &memory, int &cycles) {
-    const Word value = getAddress(cycles, memory, mode, "JMP");
+template<Cpu::instructionModes mode>
+void Cpu::JMP(Memory &memory, int &cycles) {
+    const Word value = getAddress<mode>(memory);
     PC = value;
 }
 
 void Cpu::SEI(Memory &memory, int &cycles) {
-    I = 1; cycles--; totalCycles++;
+    I = 1;
 }
 
 void Cpu::SED(Memory &memory, int &cycles) {
-    D = 1; cycles--; totalCycles++;
+    D = 1;
 }
 
 void Cpu::SEC(Memory &memory, int &cycles) {
-    C = 1; cycles--; totalCycles++;
+    setCarry(true);
 }
 
 void Cpu::CLC(Memory &memory, int &cycles) {
-    C = 0; cycles--; totalCycles++;
+    setCarry(false);
 }
 
 void Cpu::CLD(Memory &memory, int &cycles) {
-    D = 0; cycles--; totalCycles++;
+    D = 0;
 }
 
 void Cpu::CLI(Memory &memory, int &cycles) {
-    I = 0; cycles--; totalCycles++;
+    I = 0;
 }
 
 void Cpu::CLV(Memory &memory, int &cycles) {
-    V = 0; cycles--; totalCycles++;
+    setOverflow(false);
 }
 
 void Cpu::TAX(Memory &memory, int &cycles) {
-    setReg(x, A); cycles--; totalCycles++;
+    setReg(x, A);
     setZ(x);
     setN(x);
 }
 
 void Cpu::TAY(Memory &memory, int &cycles) {
-    setReg(y, A); cycles--; totalCycles++;
+    setReg(y, A);
     setZ(y);
     setN(y);
 }
 
 void Cpu::TXA(Memory &memory, int &cycles) {
-    setReg(a, X); cycles--; totalCycles++;
+    setReg(a, X);
     setZ(a);
     setN(a);
 }
 
 void Cpu::TYA(Memory &memory, int &cycles) {
-    setReg(a, Y); cycles--; totalCycles++;
+    setReg(a, Y);
     setZ(a);
     setN(a);
 }
 
 void Cpu::BCC(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (C == 0) {
+    const Byte offset = operand;
+    if (!carry()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BCS(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (C == 1) {
+    const Byte offset = operand;
+    if (carry()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BEQ(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (Z == 1) {
+    const Byte offset = operand;
+    if (zero()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BMI(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (N == 1) {
+    const Byte offset = operand;
+    if (negative()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BNE(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (Z == 0) {
+    const Byte offset = operand;
+    if (!zero()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BPL(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (N == 0) {
+    const Byte offset = operand;
+    if (!negative()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BVC(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (V == 0) {
+    const Byte offset = operand;
+    if (!overflow()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::BVS(Memory &memory, int &cycles) {
-    const Byte offset = fetchByte(cycles, memory);
-    if (V == 1) {
+    const Byte offset = operand;
+    if (overflow()) {
         branch(cycles, offset);
     }
 }
 
 void Cpu::PHA(Memory &memory, int &cycles) {
-    writeToStack(cycles, memory, A);
-    totalCycles++; cycles--;
+    writeToStack(memory, A);
 }
 
 void Cpu::PLA(Memory &memory, int &cycles) {
-    const Byte value = fetchFromStack(cycles, memory);
-    totalCycles++; cycles--;
+    const Byte value = fetchFromStack(memory);
     setReg(a, value);
     setZ(a);
     setN(a);
@@ -950,163 +908,237 @@ void Cpu::PLA(Memory &memory, int &cycles) {
 
 void Cpu::PHP(Memory &memory, int &cycles) {
     const Byte value = encodeFlags();
-    writeToStack(cycles, memory, value);
-    totalCycles++; cycles--;
+    writeToStack(memory, value);
 }
 
 void Cpu::PLP(Memory &memory, int &cycles) {
-    const Byte value = fetchFromStack(cycles, memory);
+    const Byte value = fetchFromStack(memory);
     decodeFlags(value);
-    totalCycles++; cycles--;
 }
 
 void Cpu::TSX(Memory &memory, int &cycles) {
-    const Byte value = fetchFromStack(cycles, memory);
+    const Byte value = fetchFromStack(memory);
     setReg(x, value);
     setZ(x);
     setN(x);
 }
 
 void Cpu::TXS(Memory &memory, int &cycles) {
-    writeToStack(cycles, memory, X);
+    writeToStack(memory, X);
 }
 
-void Cpu::ROL(const instructionModes mode, Memory &memory, int &cycles) {
-    if (mode == ACC) {
-        const Byte oldCarry = C;
+template<Cpu::instructionModes mode>
+void Cpu::ROL(Memory &memory, int &cycles) {
+    if constexpr (mode == ACC) {
+        const Byte oldCarry = carry();
         const Byte oldValue = A;
-        C = (oldValue >> 7) & 1;
+        carrySource = oldValue << 1;
         A = (A << 1) | oldCarry;
         setZ(A);
         setN(A);
-        cycles--; totalCycles++;
     } else {
-        Byte address = getAddress(cycles, memory, mode, "ROL");
-        Byte oldValue = memory[address];
-        Byte oldCarry = C;
-        C = (oldValue >> 7) & 1;
+        Byte address = getAddress<mode>(memory);
+        Byte oldValue = memory.readByte(address);
+        Byte oldCarry = carry();
+        carrySource = oldValue << 1;
         Byte result = (oldValue << 1) | oldCarry;
-        memory[address] = result;
+        memory.writeByte(address, result);
         setZ(result);
         setN(result);
-        cycles--; totalCycles++;
     }
 }
 
-void Cpu::ROR(const instructionModes mode, Memory &memory, int &cycles) {
-    if (mode == ACC) {
-        const Byte oldCarry = C;
+template<Cpu::instructionModes mode>
+void Cpu::ROR(Memory &memory, int &cycles) {
+    if constexpr (mode == ACC) {
+        const Byte oldCarry = carry();
         const Byte oldValue = A;
-        C = oldValue & 1;
+        setCarry(oldValue & 1);
         A = (A >> 1) | (oldCarry << 7);
         setZ(A);
         setN(A);
-        cycles--; totalCycles++;
     } else {
-        Word address = getAddress(cycles, memory, mode, "ROR");
-        Byte oldValue = memory[address];
-        Byte oldCarry = C;
-        C = oldValue & 1;
+        Word address = getAddress<mode>(memory);
+        Byte oldValue = memory.readByte(address);
+        Byte oldCarry = carry();
+        setCarry(oldValue & 1);
         Byte result = (oldValue >> 1) | (oldCarry << 7);
-        memory[address] = result;
+        memory.writeByte(address, result);
         setZ(result);
         setN(result);
-        cycles--; totalCycles++;
     }
 }
 
-void Cpu::CPX(const instructionModes mode, Memory &memory, int &cycles) {
-    const Byte value = getValueFromAddress(cycles, memory, mode, "CPX");
-    const Word sum = static_cast<uint16_t>(X) - static_cast<uint16_t>(value);
+template<Cpu::instructionModes mode>
+void Cpu::CPX(Memory &memory, int &cycles) {
+    const Byte value = getValueFromAddress<mode>(cycles, memory);
+    const Word sum = static_cast<uint16_t>(X) + static_cast<Byte>(~value) + 1; //Bit 8 set when X >= value
     const Byte result = static_cast<Byte>(sum & 0xFF);
 
-    C = X >= value;
-    Z = X == value;
+    carrySource = sum;
+    setZ(result);
     setN(result);
 }
 
-void Cpu::CPY(const instructionModes mode, Memory &memory, int &cycles) {
-    const Byte value = getValueFromAddress(cycles, memory, mode, "CPY");
-    const Word sum = static_cast<uint16_t>(Y) - static_cast<uint16_t>(value);
+template<Cpu::instructionModes mode>
+void Cpu::CPY(Memory &memory, int &cycles) {
+    const Byte value = getValueFromAddress<mode>(cycles, memory);
+    const Word sum = static_cast<uint16_t>(Y) + static_cast<Byte>(~value) + 1; //Bit 8 set when Y >= value
     const Byte result = static_cast<Byte>(sum & 0xFF);
 
-    C = Y >= value;
-    Z = Y == value;
+    carrySource = sum;
+    setZ(result);
     setN(result);
 }
 
 void Cpu::JSR(Memory &memory, int &cycles) {
-    Word returnAddress = PC - 1;
-    writeWordToStack(cycles, memory, returnAddress);
-    PC = fetchWord(cycles, memory);
-    totalCycles++; cycles--;
+    const Word returnAddress = PC - 1; //Last byte of the JSR instruction
+    writeWordToStack(memory, returnAddress);
+    PC = operand;
 }
 
 void Cpu::RTS(Memory &memory, int &cycles) {
-    Word returnAddress = fetchWordFromStack(cycles, memory);
+    Word returnAddress = fetchWordFromStack(memory);
     PC = returnAddress + 1;
-    totalCycles++; cycles--;
 }
 
 void Cpu::BRK(Memory &memory, int &cycles) {
-    writeWordToStack(cycles, memory, PC);
-    writeToStack(cycles, memory, encodeFlags());
+    writeWordToStack(memory, PC);
+    writeToStack(memory, encodeFlags());
     B = 1;
-    PC = memory[0xFFFE] + (memory[0xFFFF] << 8);
+    PC = memory.readByte(0xFFFE) + (memory.readByte(0xFFFF) << 8);
+}
+
+void Cpu::assertIRQ() {
+    if (!(pendingInterrupts & IRQ_PENDING)) {
+        irqAssertedAt = totalCycles;
+    }
+    pendingInterrupts |= IRQ_PENDING;
+}
+
+void Cpu::releaseIRQ() {
+    pendingInterrupts &= ~IRQ_PENDING;
+}
+
+void Cpu::assertNMI() {
+    if (!(pendingInterrupts & NMI_PENDING)) {
+        nmiAssertedAt = totalCycles;
+    }
+    pendingInterrupts |= NMI_PENDING;
+}
+
+// Same stack frame as BRK but with B clear, 7 cycles. A masked IRQ stays
+// pending, so the run loop keeps calling in here until CLI or RTI unmasks it.
+void Cpu::interrupt(int &cycles, Memory &memory) {
+    const bool nmi = pendingInterrupts & NMI_PENDING;
+    if (!nmi && I) {
+        return;
+    }
+    const uint64_t assertedAt = nmi ? nmiAssertedAt : irqAssertedAt;
+    pendingInterrupts &= nmi ? ~NMI_PENDING : ~IRQ_PENDING;
+
+    const uint64_t latency = totalCycles - assertedAt;
+    (nmi ? interrupts.nmis : interrupts.irqs)++;
+    interrupts.latencyCycles += latency;
+    interrupts.maxLatency = std::max(interrupts.maxLatency, latency);
+    if (interruptListener) {
+        interruptListener->interruptTaken(nmi);
+    }
+
+    writeWordToStack(memory, PC);
+    writeToStack(memory, encodeFlags() & ~0x10);
+    I = 1;
+    const Word vector = nmi ? 0xFFFA : 0xFFFE;
+    const Byte low = readByte(memory, vector);
+    PC = low | (readByte(memory, vector + 1) << 8);
+    addCycles(cycles, 7);
+    if constexpr (profilingEnabled) {
+        if (profiler) {
+            profiler->call(PC, static_cast<Byte>(SP + 3));
+        }
+    }
 }
 
 void Cpu::RTI(Memory &memory, int &cycles) {
-    decodeFlags(fetchFromStack(cycles, memory));
-    PC = fetchWordFromStack(cycles, memory);
+    decodeFlags(fetchFromStack(memory));
+    PC = fetchWordFromStack(memory);
 }
 
-void Cpu::BIT(const instructionModes mode, Memory &memory, int &cycles) {
-    const Byte value = getValueFromAddress(cycles, memory, mode, "BIT");
+template<Cpu::instructionModes mode>
+void Cpu::BIT(Memory &memory, int &cycles) {
+    const Byte value = getValueFromAddress<mode>(cycles, memory);
     const Byte result = A & value;
 
-    V = (value >> 6) & 1;
+    setOverflow((value >> 6) & 1);
     setZ(result);
     setN(value);
 }
 
-void Cpu::LSR(const instructionModes mode, Memory &memory, int &cycles) {
-    if (mode == ACC) {
-        C = A & 0x01;
+template<Cpu::instructionModes mode>
+void Cpu::LSR(Memory &memory, int &cycles) {
+    if constexpr (mode == ACC) {
+        setCarry(A & 0x01);
         A >>= 1;
         setZ(A);
         setN(A);
-        cycles--; totalCycles++;
     } else {
-        const Word address = getAddress(cycles, memory, mode, "LSR");
-        Byte value = memory[address];
-        C = value & 0x01;
+        const Word address = getAddress<mode>(memory);
+        Byte value = memory.readByte(address);
+        setCarry(value & 0x01);
         value >>= 1;
-        memory[address] = value;
+        memory.writeByte(address, value);
         setZ(value);
         setN(value);
-        cycles--; totalCycles++;
     }
 }
 
-void Cpu::ASL(const instructionModes mode, Memory &memory, int &cycles) {
-    if (mode == ACC) {
-        C = (A >> 7) & 1;
+template<Cpu::instructionModes mode>
+void Cpu::ASL(Memory &memory, int &cycles) {
+    if constexpr (mode == ACC) {
+        carrySource = A << 1;
         A <<= 1;
         setZ(A);
         setN(A);
-        cycles--; totalCycles++;
     } else {
-        const Word address = getAddress(cycles, memory, mode, "ASL");
-        Byte value = memory[address];
-        C = (value >> 7) & 1;
+        const Word address = getAddress<mode>(memory);
+        Byte value = memory.readByte(address);
+        carrySource = value << 1;
         value <<= 1;
-        memory[address] = value;
+        memory.writeByte(address, value);
         setZ(value);
         setN(value);
-        cycles--; totalCycles++;
     }
 }
 
+void Cpu::NOP(Memory &memory, int &cycles) {
+}
+
+void Cpu::HLT(Memory &memory, int &cycles) {
+    if constexpr (defaultTraceLevel == TraceLevel::TEXT) {
+        std::cout << "\nHalting CPU - encountered 0xFF";
+    }
+    cycles = 0;
+    halted = true;
+}
+
+void Cpu::ILL(Memory &memory, int &cycles) {
+    Emulator::log(totalCycles, Emulator::ERROR, "Unknown instruction: ", memory.readByte(static_cast<Word>(PC - 1)));
+}
+
+const std::array<Cpu::OpHandler, 256> Cpu::opcodeTable = {
+#define OPCODE(code, handler, bytes, cycles) &Cpu::handler,
+#include "Opcodes.def"
+#undef OPCODE
+};
+
+const std::array<Cpu::Byte, 256> Cpu::operandBytes = {
+#define OPCODE(code, handler, bytes, cycles) bytes,
+#include "Opcodes.def"
+#undef OPCODE
+};
+
 Cpu::Cpu(Memory &mem) {
     reset(mem);
-}
\ No newline at end of file
+}
+
+Cpu::~Cpu() = default;
\ No newline at end of file
@@ -5,23 +5,105 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "BlockCache.h"
+#include "Jit.h"
 #include "Memory.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "Trace.h"
 class Emulator;
 
+// Told about every hardware interrupt the CPU takes, at the instruction
+// boundary it is taken at (e.g. to log it for a deterministic replay).
+class InterruptListener {
+public:
+    virtual void interruptTaken(bool nmi) = 0;
+protected:
+    ~InterruptListener() = default;
+};
+
 class Cpu {
-private:
     using Byte = unsigned char;
     using Word = unsigned short;
+    friend class Batch; //Steps single lanes through the interpreter
+    friend class Replay; //Re-runs a recording without the live scheduler
+
+public:
+    enum class Engine {INTERPRETER, BLOCK_CACHE, JIT}; //Run loop behind execute()
+
+    // Architectural state, enough to compare or restore two CPUs
+    struct State {
+        Word PC;
+        Byte A, X, Y, SP, status;
+        uint64_t totalCycles;
+        bool operator==(const State&) const = default;
+    };
 
+    struct InterruptStats {
+        uint64_t irqs = 0, nmis = 0;
+        uint64_t latencyCycles = 0;   //Summed from assertion to the start of the handler
+        uint64_t maxLatency = 0;
+        [[nodiscard]] double averageLatency() const {
+            return irqs + nmis ? static_cast<double>(latencyCycles) / static_cast<double>(irqs + nmis) : 0;
+        }
+    };
+
+    // Counted since reset (or the last loadState() for cycles)
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;    //Retired, interrupt entries not included
+        InterruptStats interrupts;
+        [[nodiscard]] double cyclesPerInstruction() const {
+            return instructions ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0;
+        }
+    };
+
+    // Cycles of each opcode without page-cross and taken-branch extras, from Opcodes.def
+    static constexpr std::array<unsigned char, 256> baseCycles = {
+#define OPCODE(code, handler, bytes, cycles) cycles,
+#include "Opcodes.def"
+#undef OPCODE
+    };
+
+    alignas(64) Word PC{}; //Program counter  (out of private for debug purposes)
+
+private:
+    // Everything the run loop touches per instruction is declared here, next to
+    // PC, so the whole hot state shares one cache line.
     Byte SP{}; //Stack pointer
     Byte A{}, X{}, Y{}; //Registers
-    Byte C : 1{}; //Carry flag
-    Byte Z : 1{}; //Zero flag
-    Byte I : 1{}; //Interrupt disable
-    Byte D : 1{}; //Decimal mode
-    Byte B : 1{}; //Break command
-    Byte V : 1{}; //Overflow flag
-    Byte N : 1{}; //Negative flag
+    Byte I{}; //Interrupt disable
+    Byte D{}; //Decimal mode
+    Byte B{}; //Break command
+
+    // Lazy flags: the values that produced C/Z/N/V are stored as they are and
+    // only folded into bits when something reads them (branches, PHP, BRK...)
+    Word carrySource{}; //Carry = bit 8, like the 9-bit sum of ADC
+    Byte zeroSource{1}; //Zero = value is zero
+    Byte negativeSource{}; //Negative = bit 7 of value
+    Byte overflowLeft{}, overflowRight{}, overflowResult{}; //Overflow = same-sign operands, result of the other sign
+    Word operand{}; //Operand bytes of the current instruction, fetched before its handler runs
+    uint64_t totalCycles{};
+    uint64_t retired{}; //Instructions completed, interrupt entries not included
+    uint32_t pendingInterrupts{}; //IRQ_PENDING | NMI_PENDING, checked at every instruction boundary
+
+    [[nodiscard]] Byte carry() const { return carrySource >> 8; }
+    [[nodiscard]] Byte zero() const { return zeroSource == 0; }
+    [[nodiscard]] Byte negative() const { return negativeSource >> 7; }
+    [[nodiscard]] Byte overflow() const {
+        return (~(overflowLeft ^ overflowRight) & (overflowLeft ^ overflowResult) & 0x80) >> 7;
+    }
+    void setCarry(const bool value) { carrySource = value << 8; }
+    void setOverflow(const bool value) { overflowLeft = overflowRight = 0; overflowResult = value << 7; }
+
+    // Every cycle is charged through here: the base count when an opcode is
+    // dispatched, then page crosses, taken branches and interrupt entry
+    void addCycles(int &cycles, const int count) { cycles -= count; totalCycles += count; }
 
     enum instructionModes {ACC, IM, ZP, ZPX, ZPY, REL, ABS, ABX, ABY, INDX, INDY, IN};
     static std::string toString(instructionModes mode);
@@ -30,30 +112,107 @@ private:
     void decodeFlags(Byte status);
 
     Emulator* emulator = nullptr;
-    int totalCycles{};
+    TraceSink* traceSink = nullptr;
+    Profiler* profiler = nullptr;
+    InterruptListener* interruptListener = nullptr;
+    Engine engine = Engine::INTERPRETER;
+
+    using OpHandler = void (Cpu::*)(Memory &memory, int &cycles);
+    static const std::array<OpHandler, 256> opcodeTable; //Built from Opcodes.def
+    static const std::array<Byte, 256> operandBytes;
+
+    template<int bytes> void fetchOperand(Memory &memory);
+    template<TraceLevel trace> void traceInstruction(Word pc, Byte instruction);
+    void profileInstruction(const Word pc, const Byte instruction, const uint64_t start) {
+        if constexpr (profilingEnabled) {
+            if (profiler) {
+                profiler->record(pc, instruction, static_cast<uint32_t>(totalCycles - start), PC, SP);
+            }
+        }
+    }
+    template<TraceLevel trace> void step(int &cycles, Memory &memory);
+
+    std::unique_ptr<BlockCache> blockCache;
+    BlockCache::Block* decodeBlock(Word pc, Memory &memory);
+
+    std::unique_ptr<Jit> jit;
+    void runNative(Jit::Block &block, int &cycles, Memory &memory);
+
+    static constexpr uint32_t IRQ_PENDING = 1;
+    static constexpr uint32_t NMI_PENDING = 2;
+    uint64_t irqAssertedAt = 0, nmiAssertedAt = 0;
+    void interrupt(int &cycles, Memory &memory);
+    [[nodiscard]] bool interruptDue() const { return (pendingInterrupts & NMI_PENDING) || (pendingInterrupts && !I); }
+
+    // PC | SP << 16 | stack top << 32 for a Sampler thread, one relaxed store
+    // per instruction (per block for the block cache and native code). On its
+    // own line so the reader does not pull the registers away from this thread.
+    alignas(64) std::atomic<uint64_t> published{IDLE_SAMPLE};
+    std::atomic<bool> sampleStack{false}; //Also publish the word above SP, the usual return address
+    void publish(const Memory &memory) {
+        uint64_t sample = PC | SP << 16;
+        if (sampleStack.load(std::memory_order_relaxed)) [[unlikely]] {
+            sample |= static_cast<uint64_t>(memory.readByte(0x0100 + ((SP + 1) & 0xFF)) |
+                                            memory.readByte(0x0100 + ((SP + 2) & 0xFF)) << 8) << 32;
+        }
+        published.store(sample, std::memory_order_relaxed);
+    }
+
+    Scheduler scheduler;
+    bool halted = false; //HLT ran, ends a sliced execute() early
+    InterruptStats interrupts;
+    void runEngine(int cycles, Memory &memory);
 public:
-    Word PC{}; //Program counter                (out of private for debug purposes)
     enum registers {a, x, y}; //Register names  (out of private for debug purposes)
     enum flags {c, z, i, d, b, v, n}; //        (out of private for debug purposes)
 
     explicit Cpu(Memory & mem);
+    ~Cpu();
 
     void attachEmulator(Emulator* emu);
+    void attachTraceSink(TraceSink* sink);
+    void attachProfiler(Profiler* newProfiler); //Only records in EMU_PROFILE builds
+    void attachInterruptListener(InterruptListener* listener);
+    void setEngine(Engine newEngine);
+    [[nodiscard]] Engine getEngine() const { return engine; }
     void reset(Memory &memory);
     void execute(int cycles, Memory &memory);
+    [[nodiscard]] bool hasHalted() const { return halted; } //The last execute() stopped at HLT
+    [[nodiscard]] Scheduler &events() { return scheduler; } //Deadlines count in totalCycles
+
+    // Hardware interrupt inputs, for the emulation thread (e.g. from a scheduler
+    // event or a device handler). A request is taken at the next instruction
+    // boundary: PC and status are pushed, I is set and PC is loaded from $FFFA
+    // (NMI) or $FFFE (IRQ). An IRQ waits while I is set, until releaseIRQ().
+    void assertIRQ();
+    void releaseIRQ();
+    void assertNMI();
+
+    [[nodiscard]] Stats stats() const { return {totalCycles, retired, interrupts}; }
 
-    Byte fetchByte(int &cycles, Memory &memory);
-    Byte readByte(int &cycles, Memory &memory, Word addr);
-    Word fetchWord(int &cycles, Memory &memory);
-    Word readWord(int &cycles, Memory &memory, Word addr);
+    // Position of the running CPU for a sampling thread, IDLE_SAMPLE outside execute()
+    static constexpr uint64_t IDLE_SAMPLE = uint64_t{1} << 63;
+    [[nodiscard]] uint64_t sample() const { return published.load(std::memory_order_relaxed); }
+    void publishStack(const bool enabled) { sampleStack.store(enabled, std::memory_order_relaxed); }
+    template<TraceLevel trace> void run(int cycles, Memory &memory);
+    template<TraceLevel trace> void runBlocks(int cycles, Memory &memory);
+    template<TraceLevel trace> void runJit(int cycles, Memory &memory);
 
-    void writeToStack(int &cycles, Memory &memory, Byte value);
-    void writeWordToStack(int &cycles, Memory &memory, Word value);
-    Byte fetchFromStack(int &cycles, Memory &memory);
-    Word fetchWordFromStack(int &cycles, Memory &memory);
+    [[nodiscard]] State saveState() const;
+    void loadState(const State &state);
 
-    Byte getValueFromZP(int &cycles, Memory &memory, instructionModes mode);
-    Word getValueFromABS(int &cycles, Memory &memory, instructionModes mode);
+    Byte fetchByte(Memory &memory);
+    Byte readByte(Memory &memory, Word addr);
+    Word fetchWord(Memory &memory);
+    Word readWord(Memory &memory, Word addr);
+
+    void writeToStack(Memory &memory, Byte value);
+    void writeWordToStack(Memory &memory, Word value);
+    Byte fetchFromStack(Memory &memory);
+    Word fetchWordFromStack(Memory &memory);
+
+    template<instructionModes mode> Byte getValueFromZP(int &cycles, Memory &memory);
+    template<instructionModes mode> Byte getValueFromABS(int &cycles, Memory &memory);
 
     void setReg(registers reg, Byte value);
     void setZ(Byte value);
@@ -62,20 +221,20 @@ public:
     [[nodiscard]] Byte returnFlag(flags flag) const;
 
     void branch(int &cycles, Byte offset);
-    Word getValueFromAddress(int &cycles, Memory &memory, instructionModes mode, const std::string &instruction);
-    Word getAddress(int &cycles, Memory &memory, instructionModes mode, const std::string& instruction);
+    template<instructionModes mode> Byte getValueFromAddress(int &cycles, Memory &memory);
+    template<instructionModes mode> Word getAddress(Memory &memory);
 
-    //Processor Opcodes:
-    void ADC(instructionModes mode, Memory &memory, int &cycles);
-    void SBC(instructionModes mode, Memory &memory, int &cycles);
-    void CMP(instructionModes mode, Memory &memory, int &cycles);
+    //Processor Opcodes (addressing mode resolved at compile time, one table entry per opcode):
+    template<instructionModes mode> void ADC(Memory &memory, int &cycles);
+    template<instructionModes mode> void SBC(Memory &memory, int &cycles);
+    template<instructionModes mode> void CMP(Memory &memory, int &cycles);
 
-    void AND(instructionModes mode, Memory &memory, int &cycles);
-    void EOR(instructionModes mode, Memory &memory, int &cycles);
-    void ORA(instructionModes mode, Memory &memory, int &cycles);
-    void CPY(instructionModes mode, Memory &memory, int &cycles);
-    void CPX(instructionModes mode, Memory &memory, int &cycles);
-    void BIT(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void AND(Memory &memory, int &cycles);
+    template<instructionModes mode> void EOR(Memory &memory, int &cycles);
+    template<instructionModes mode> void ORA(Memory &memory, int &cycles);
+    template<instructionModes mode> void CPY(Memory &memory, int &cycles);
+    template<instructionModes mode> void CPX(Memory &memory, int &cycles);
+    template<instructionModes mode> void BIT(Memory &memory, int &cycles);
 
     void BCC(Memory &memory, int &cycles);
     void BCS(Memory &memory, int &cycles);
@@ -88,25 +247,25 @@ public:
 
     void INY(Memory &memory, int &cycles);
     void INX(Memory &memory, int &cycles);
-    void INC(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void INC(Memory &memory, int &cycles);
     void DEY(Memory &memory, int &cycles);
     void DEX(Memory &memory, int &cycles);
-    void DEC(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void DEC(Memory &memory, int &cycles);
 
-    void LDX(instructionModes mode, Memory &memory, int &cycles);
-    void LDY(instructionModes mode, Memory &memory, int &cycles);
-    void LDA(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void LDX(Memory &memory, int &cycles);
+    template<instructionModes mode> void LDY(Memory &memory, int &cycles);
+    template<instructionModes mode> void LDA(Memory &memory, int &cycles);
 
-    void STX(instructionModes mode, Memory &memory, int &cycles);
-    void STY(instructionModes mode, Memory &memory, int &cycles);
-    void STA(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void STX(Memory &memory, int &cycles);
+    template<instructionModes mode> void STY(Memory &memory, int &cycles);
+    template<instructionModes mode> void STA(Memory &memory, int &cycles);
 
     void TAX(Memory &memory, int &cycles);
     void TAY(Memory &memory, int &cycles);
     void TXA(Memory &memory, int &cycles);
     void TYA(Memory &memory, int &cycles);
 
-    void JMP(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void JMP(Memory &memory, int &cycles);
     void JSR(Memory &memory, int &cycles);
     void RTS(Memory &memory, int &cycles);
     void BRK(Memory &memory, int &cycles);
@@ -128,10 +287,14 @@ public:
     void TSX(Memory &memory, int &cycles);
     void TXS(Memory &memory, int &cycles);
 
-    void ROR(instructionModes mode, Memory &memory, int &cycles);
-    void ROL(instructionModes mode, Memory &memory, int &cycles);
-    void ASL(instructionModes mode, Memory &memory, int &cycles);
-    void LSR(instructionModes mode, Memory &memory, int &cycles);
+    template<instructionModes mode> void ROR(Memory &memory, int &cycles);
+    template<instructionModes mode> void ROL(Memory &memory, int &cycles);
+    template<instructionModes mode> void ASL(Memory &memory, int &cycles);
+    template<instructionModes mode> void LSR(Memory &memory, int &cycles);
+
+    void NOP(Memory &memory, int &cycles);
+    void HLT(Memory &memory, int &cycles); //Custom opcode 0xFF
+    void ILL(Memory &memory, int &cycles); //Unknown opcode
 
 };
 
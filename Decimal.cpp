@@ -0,0 +1,42 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Decimal.h"
+
+const std::array<uint16_t, 0x20000> Decimal::sums = [] {
+    std::array<uint16_t, 0x20000> table{};
+    for (uint32_t index = 0; index < table.size(); index++) {
+        const uint32_t carry = index >> 16, a = (index >> 8) & 0xFF, value = index & 0xFF;
+        uint32_t low = (a & 0x0F) + (value & 0x0F) + carry;
+        if (low > 0x09) {
+            low += 0x06;
+        }
+        uint32_t high = (a >> 4) + (value >> 4) + (low > 0x0F);
+        const uint32_t sign = (high << 4) & 0x80; //N and V look at the digit before it is adjusted
+        if (high > 0x09) {
+            high += 0x06;
+        }
+        table[index] = static_cast<uint16_t>((((high << 4) | (low & 0x0F)) & 0xFF) | (high > 0x0F) << 8 | sign << 8);
+    }
+    return table;
+}();
+
+const std::array<uint8_t, 0x20000> Decimal::differences = [] {
+    std::array<uint8_t, 0x20000> table{};
+    for (uint32_t index = 0; index < table.size(); index++) {
+        const int carry = static_cast<int>(index >> 16);
+        const int a = static_cast<int>((index >> 8) & 0xFF), value = static_cast<int>(index & 0xFF);
+        int low = (a & 0x0F) - (value & 0x0F) - (1 - carry);
+        int high = (a >> 4) - (value >> 4);
+        if (low < 0) {
+            low -= 0x06; //Borrow from the high digit
+            high--;
+        }
+        if (high < 0) {
+            high -= 0x06;
+        }
+        table[index] = static_cast<uint8_t>((high << 4) | (low & 0x0F));
+    }
+    return table;
+}();
@@ -0,0 +1,33 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <array>
+#include <cstdint>
+
+// NMOS 6502 decimal mode ADC/SBC, precomputed for every carry, A and operand
+// (index carry << 16 | A << 8 | operand), so a decimal instruction costs one
+// load like a binary one. Operands that are not valid BCD give the same
+// results as the chip. On NMOS the decimal sum still sets Z from the binary
+// sum and N/V from the sum before its high digit is adjusted; SBC only fixes
+// up the result and leaves every flag to the binary difference.
+class Decimal {
+public:
+    // Low byte the result, bit 8 the carry out, bit 15 the N/V source bit
+    [[nodiscard]] static uint16_t add(const uint8_t a, const uint8_t value, const bool carry) {
+        return sums[carry << 16 | a << 8 | value];
+    }
+
+    [[nodiscard]] static uint8_t subtract(const uint8_t a, const uint8_t value, const bool carry) {
+        return differences[carry << 16 | a << 8 | value];
+    }
+
+private:
+    static const std::array<uint16_t, 0x20000> sums;
+    static const std::array<uint8_t, 0x20000> differences;
+};
+
+#endif //DECIMAL_H
@@ -3,70 +3,37 @@
 //
 
 #include "Emulator.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <bits/ostream.tcc>
 #include <sstream>
 
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 Emulator::Emulator()
     : cpu(mem) {
     cpu.reset(mem);
 }
 
-#include <ctime>
-#include <string>
-
-void Emulator::log(int totalCycles, logMode mode, const std::string &message, bool withValue, const std::string &value) {
-    time_t timestamp;
-    time(&timestamp);
-    std::string timeStr = std::strtok(ctime(&timestamp), "\n");
-    std::cout << "\n[" << totalCycles << "]";
-
-    switch (mode) {
-        case INFO:
-            std::cout << "[" << timeStr << "][INFO]    ";
-            break;
-        case ERROR:
-            std::cout << "[" << timeStr << "][ERROR]   ";
-            break;
-        case SUCCESS:
-            std::cout << "[" << timeStr << "][SUCCESS] ";
-            break;
-        case WARNING:
-            std::cout << "[" << timeStr << "][WARNING] ";
-            break;
-        case DEBUG:
-            std::cout << "[" << timeStr << "][DEBUG]   ";
-            break;
-        default:
-            std::cout << "[" << timeStr << "][MESSAGE] ";
-    }
-
-    std::cout << message;
-    if (withValue) {
-        std::cout << " " << value;
-    }
-}
-
-void Emulator::log(int totalCycles, logMode mode, const std::string &message) {
-    log(totalCycles, mode, message, false, "");
+Emulator::Emulator(const Memory &memory)
+    : mem(memory), cpu(mem) {
 }
 
-void Emulator::log(int totalCycles, logMode mode, const std::string &message, Byte value) {
-    std::stringstream ss;
-    ss << "0x" << std::hex << std::uppercase << static_cast<int>(value);
-    log(totalCycles, mode, message, true, ss.str());
-}
-
-void Emulator::log(int totalCycles, logMode mode, const std::string &message, Word value) {
-    std::stringstream ss;
-    ss << "0x" << std::hex << std::uppercase << value;
-    log(totalCycles, mode, message, true, ss.str());
-}
-
-void Emulator::log(int totalCycles, logMode mode, const std::string &message, const std::string &value) {
-    log(totalCycles, mode, message, true, value);
+std::unique_ptr<Emulator> Emulator::fork() const {
+    std::unique_ptr<Emulator> child(new Emulator(mem));
+    child->cpu.setEngine(cpu.getEngine());
+    child->cpu.loadState(cpu.saveState());
+    return child;
 }
 
 void Emulator::readROM(const std::string &name) {
@@ -104,14 +71,66 @@ void Emulator::loadROMIntoMem(const Word addr) {
 
 
 
+bool Emulator::mapROM(const std::string &name, const Word addr, const bool resetVector) {
+    return mapROM(mem, name, addr, resetVector);
+}
+
+bool Emulator::mapROM(Memory &memory, const std::string &name, const Word addr, const bool resetVector) {
+    std::shared_ptr<Byte[]> image;
+    size_t size = 0;
+#ifdef __unix__
+    const int file = open(name.c_str(), O_RDONLY);
+    if (file < 0) {
+        log(0, ERROR, "Failed to open ROM: ", name);
+        return false;
+    }
+    struct stat info{};
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        size = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped != MAP_FAILED) {
+            //Unmapped once the last Memory sharing one of its pages lets go
+            image = std::shared_ptr<Byte[]>(static_cast<Byte*>(mapped), [size](const Byte* bytes) {
+                munmap(const_cast<Byte*>(bytes), size);
+            });
+        }
+    }
+    close(file);
+#else
+    std::ifstream file(name, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        log(0, ERROR, "Failed to open ROM: ", name);
+        return false;
+    }
+    size = static_cast<size_t>(file.tellg());
+    image = std::shared_ptr<Byte[]>(new Byte[size]);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(image.get()), static_cast<std::streamsize>(size));
+#endif
+    if (!image) {
+        log(0, ERROR, "Failed to map ROM: ", name);
+        return false;
+    }
+    if (addr + size > 0x10000) {
+        log(0, WARNING, "ROM runs past $FFFF, the rest is dropped: ", name);
+    }
+    memory.mapShared(addr, image, static_cast<uint32_t>(std::min<size_t>(size, 0x10000)));
+
+    if (resetVector && (addr > 0xFFFC || addr + size <= 0xFFFC)) {
+        memory.writeByte(0xFFFC, static_cast<Byte>(addr & 0x00FF));
+        memory.writeByte(0xFFFD, static_cast<Byte>((addr >> 8) & 0x00FF));
+    }
+    return true;
+}
+
 void Emulator::loadByteIntoMem(Byte instruction, Word addr) {
-    mem.Data[addr] = instruction;
+    mem.writeByte(addr, instruction);
 }
 
 void Emulator::showMemory(const Word startingAddress, const Word endingAddress) const {
     log(0, INFO, "Showing memory:\n");
     for (Word i = startingAddress; i < endingAddress; i++) {
-        std::cout << std::hex << static_cast<int>(mem.Data[i]) << std::hex << " ";
+        std::cout << std::hex << static_cast<int>(mem[i]) << std::hex << " ";
     }
     std::cout << "\n";
 }
@@ -126,3 +145,14 @@ void Emulator::showFlag(Cpu::flags flag) const {
     std::cout << "Flag " << flag << ": " << static_cast<int>(cpu.returnFlag(flag)) << "\n";
 }
 
+bool Emulator::parseCount(const std::string &text, uint64_t &count) {
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || errno == ERANGE) {
+        log(0, ERROR, "Not a count: ", text);
+        return false;
+    }
+    count = value;
+    return true;
+}
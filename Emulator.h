@@ -7,8 +7,12 @@
 
 #include <cmath>
 #include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include "CPU.h"
+#include "Log.h"
 #include "Memory.h"
 class Cpu;
 
@@ -25,20 +29,51 @@ public:
     std::vector<Byte> ROM;
 
     Emulator();
+    [[nodiscard]] std::unique_ptr<Emulator> fork() const; //Shares memory copy-on-write, ROM is not copied
 
     void readROM(const std::string &name);
     void loadROMIntoMem(Word addr);
+    // Maps one segment of ROM straight from the file, without the ROM vector.
+    // Full pages stay shared with the file until written. Call once per segment.
+    // The reset vector points at addr unless resetVector is false or the
+    // segment covers $FFFC itself.
+    bool mapROM(const std::string &name, Word addr, bool resetVector = true);
+    static bool mapROM(Memory &memory, const std::string &name, Word addr, bool resetVector = true);
     void loadByteIntoMem(Byte instruction, Word addr = 0x0000);
 
-    static void log(int totalCycles, logMode mode, const std::string &message);
-    static void log(int totalCycles, logMode mode, const std::string &message, Byte value);
-    static void log(int totalCycles, logMode mode, const std::string &message, Word value);
-    static void log(int totalCycles, logMode mode, const std::string &message, const std::string &value);
-    static void log(int totalCycles, logMode mode, const std::string &message, bool withValue, const std::string &value);
+    // Queued for the log thread (see Log), messages should be literals. Levels
+    // below EMU_LOG_LEVEL cost nothing, the mode is a constant at every call.
+    static void log(const uint64_t totalCycles, const logMode mode, const char* message) {
+        if (Log::enabled(level(mode))) Log::write(totalCycles, level(mode), message);
+    }
+    static void log(const uint64_t totalCycles, const logMode mode, const char* message, const Byte value) {
+        if (Log::enabled(level(mode))) Log::write(totalCycles, level(mode), message, value);
+    }
+    static void log(const uint64_t totalCycles, const logMode mode, const char* message, const Word value) {
+        if (Log::enabled(level(mode))) Log::write(totalCycles, level(mode), message, value);
+    }
+    static void log(const uint64_t totalCycles, const logMode mode, const char* message, std::string value) {
+        if (Log::enabled(level(mode))) Log::write(totalCycles, level(mode), message, std::move(value));
+    }
+    static void log(const uint64_t totalCycles, const logMode mode, std::string message, std::string value) {
+        if (Log::enabled(level(mode))) Log::write(totalCycles, level(mode), std::move(message), std::move(value));
+    }
+
+    // A command line count: plain decimal digits that fit in 64 bits. Anything
+    // else is logged and leaves count alone.
+    static bool parseCount(const std::string &text, uint64_t &count);
 
     void showMemory(Word startingAddress = 0x0000, Word endingAddress = 0x00FF) const;
     void showRegisters() const;
     void showFlag(Cpu::flags flag) const;
+
+private:
+    explicit Emulator(const Memory &memory);
+
+    static constexpr Log::Level level(const logMode mode) {
+        constexpr Log::Level levels[] = {Log::INFO, Log::ERROR, Log::SUCCESS, Log::WARNING, Log::DEBUG};
+        return levels[mode];
+    }
 };
 
 #endif //EMULATOR_H
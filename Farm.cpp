@@ -0,0 +1,245 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Farm.h"
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "Emulator.h"
+
+bool Farm::Deque::pop(size_t &item) {
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    item = items[b];
+    if (t == b) {
+        //Last item, race the thieves for it
+        const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool Farm::Deque::steal(size_t &item) {
+    while (true) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        item = items[t];
+        if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+Farm::ResultQueue::ResultQueue(const size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots = std::make_unique<Slot[]>(size);
+    for (size_t i = 0; i < size; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+}
+
+bool Farm::ResultQueue::push(Result &&result) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    while (true) {
+        Slot &slot = slots[position & mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.result = std::move(result);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false; //Full
+        } else {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Farm::ResultQueue::pop(Result &result) {
+    size_t position = head.load(std::memory_order_relaxed);
+    while (true) {
+        Slot &slot = slots[position & mask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (difference == 0) {
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                result = std::move(slot.result);
+                slot.sequence.store(position + mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false; //Empty
+        } else {
+            position = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+Farm::Farm(unsigned workers, const size_t resultCapacity) : results(resultCapacity) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        emulators.push_back(std::make_unique<Emulator>());
+        deques.push_back(std::make_unique<Deque>());
+    }
+    workerStats.resize(workers);
+}
+
+Farm::~Farm() = default;
+
+size_t Farm::submit(Job job) {
+    jobs.push_back(std::move(job));
+    return nextJob++;
+}
+
+void Farm::run() {
+    //Images are mapped once up front, every job forks its memory from them.
+    //One that fails to load is left out and its jobs fail in runJob.
+    std::set<Image> failed;
+    for (const Job &job : jobs) {
+        const Image key{job.rom, job.loadAddress};
+        if (images.contains(key) || failed.contains(key)) {
+            continue;
+        }
+        Memory &memory = images[key];
+        if (!Emulator::mapROM(memory, job.rom, job.loadAddress, false)) {
+            images.erase(key);
+            failed.insert(key);
+            continue;
+        }
+        memory.writeByte(0xFFFC, static_cast<Byte>(job.loadAddress & 0x00FF));
+        memory.writeByte(0xFFFD, static_cast<Byte>((job.loadAddress >> 8) & 0x00FF));
+        memory.share(); //Workers fork concurrently, so they must not have to mark it
+    }
+
+    for (const std::unique_ptr<Deque> &deque : deques) {
+        deque->items.clear();
+    }
+    for (size_t i = 0; i < jobs.size(); i++) {
+        deques[i % deques.size()]->items.push_back(i);
+    }
+    for (const std::unique_ptr<Deque> &deque : deques) {
+        deque->reset();
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned worker = 1; worker < workers(); worker++) {
+        threads.emplace_back(&Farm::work, this, worker);
+    }
+    work(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    firstJob += jobs.size();
+    jobs.clear();
+}
+
+bool Farm::poll(Result &result) {
+    if (results.pop(result)) {
+        return true;
+    }
+    const std::lock_guard<std::mutex> lock(overflowLock);
+    if (overflow.empty()) {
+        return false;
+    }
+    result = std::move(overflow.back());
+    overflow.pop_back();
+    return true;
+}
+
+bool Farm::steal(const unsigned thief, size_t &job) {
+    for (unsigned i = 1; i < workers(); i++) {
+        if (deques[(thief + i) % workers()]->steal(job)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Farm::work(const unsigned worker) {
+    Emulator &emulator = *emulators[worker];
+    WorkerStats &stats = workerStats[worker];
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t job;
+    while (true) {
+        if (!deques[worker]->pop(job)) {
+            if (!steal(worker, job)) {
+                break; //Nothing is added during a run, so all deques are drained
+            }
+            stats.stolen++;
+        }
+        Result result = runJob(emulator, worker, job);
+        stats.jobs++;
+        stats.cycles += result.state.totalCycles;
+        if (!results.push(std::move(result))) {
+            const std::lock_guard<std::mutex> lock(overflowLock); //Full, nobody may be polling yet
+            overflow.push_back(std::move(result));
+        }
+    }
+    stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Farm::Result Farm::runJob(Emulator &emulator, const unsigned worker, const size_t job) {
+    const Job &spec = jobs[job];
+    Memory &memory = emulator.mem;
+
+    const auto image = images.find({spec.rom, spec.loadAddress});
+    if (image == images.end()) {
+        return {firstJob + job, worker, Cpu::State{}, {}, false};
+    }
+    memory = image->second;
+    for (const Patch &patch : spec.patches) {
+        for (size_t i = 0; i < patch.bytes.size(); i++) {
+            memory.writeByte(static_cast<Word>(patch.address + i), patch.bytes[i]);
+        }
+    }
+
+    emulator.cpu.setEngine(spec.engine);
+    emulator.cpu.reset(memory);
+    emulator.cpu.execute(spec.cycles, memory);
+
+    Result result{firstJob + job, worker, emulator.cpu.saveState(), {}};
+    for (const Range &range : spec.dumps) {
+        std::vector<Byte> bytes(range.length);
+        for (size_t i = 0; i < range.length; i++) {
+            bytes[i] = memory.readByte(static_cast<Word>(range.start + i));
+        }
+        result.memory.push_back(std::move(bytes));
+    }
+    return result;
+}
+
+void Farm::reportStats() const {
+    for (size_t worker = 0; worker < workerStats.size(); worker++) {
+        const WorkerStats &stats = workerStats[worker];
+        std::stringstream line;
+        line << stats.jobs << " jobs (" << stats.stolen << " stolen), "
+             << stats.cyclesPerSecond() / 1e6 << " Mcycles/s";
+        Emulator::log(0, Emulator::INFO, "Worker " + std::to_string(worker) + ": ", line.str());
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef FARM_H
+#define FARM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CPU.h"
+#include "Memory.h"
+class Emulator;
+
+// Runs batches of independent ROM jobs on all cores. Jobs are dealt round robin
+// onto per-worker deques; a worker takes from the bottom of its own deque and,
+// once it is empty, steals from the top of the others. Every worker keeps one
+// Emulator for all of its jobs. Results come back through a lock-free queue of
+// fixed capacity and can be polled while the batch is still running. Results
+// that find it full go to a locked overflow list, which poll() drains once the
+// queue is empty, so nobody has to poll during run().
+class Farm {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    struct Patch {
+        Word address;
+        std::vector<Byte> bytes;
+    };
+
+    struct Range {
+        Word start;
+        Word length;
+    };
+
+    struct Job {
+        std::string rom;                     //Image file, read once per batch
+        Word loadAddress = 0x0000;           //Also becomes the reset vector
+        std::vector<Patch> patches;          //Applied after loading, before reset
+        int cycles = 0;
+        std::vector<Range> dumps;            //Memory returned with the result
+        Cpu::Engine engine = Cpu::Engine::INTERPRETER;
+    };
+
+    struct Result {
+        size_t job;                          //Index returned by submit()
+        unsigned worker;
+        Cpu::State state;                    //Registers, flags (status) and cycles
+        std::vector<std::vector<Byte>> memory; //One entry per Job::dumps range
+        bool ok = true;                      //False when the ROM could not be loaded, nothing ran
+    };
+
+    struct WorkerStats {
+        uint64_t jobs = 0;
+        uint64_t stolen = 0;                 //Jobs taken from another worker's deque
+        uint64_t cycles = 0;
+        double busySeconds = 0;
+        [[nodiscard]] double cyclesPerSecond() const { return busySeconds > 0 ? cycles / busySeconds : 0; }
+    };
+
+    static constexpr size_t RESULT_CAPACITY = 4096;
+
+    explicit Farm(unsigned workers = 0, size_t resultCapacity = RESULT_CAPACITY); //0 workers: one per hardware thread
+    ~Farm();
+
+    Farm(const Farm&) = delete;
+    Farm &operator=(const Farm&) = delete;
+
+    [[nodiscard]] unsigned workers() const { return static_cast<unsigned>(emulators.size()); }
+
+    size_t submit(Job job);                  //Queued for the next run()
+    void run();                              //Blocks until every queued job has finished
+    bool poll(Result &result);               //Any thread, also while run() is busy
+
+    [[nodiscard]] const std::vector<WorkerStats> &stats() const { return workerStats; }
+    void reportStats() const;
+
+private:
+    // Chase-Lev deque over job indices. It is filled before the workers start,
+    // so only the owner's pop and the thieves' steal run concurrently.
+    class Deque {
+    public:
+        std::vector<size_t> items;
+        bool pop(size_t &item);
+        bool steal(size_t &item);
+        void reset() { top.store(0); bottom.store(static_cast<int64_t>(items.size())); }
+    private:
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+    };
+
+    // Bounded multi-producer multi-consumer ring (Vyukov), one sequence per slot
+    class ResultQueue {
+    public:
+        explicit ResultQueue(size_t capacity);
+        bool push(Result &&result);
+        bool pop(Result &result);
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence;
+            Result result;
+        };
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    std::vector<std::unique_ptr<Emulator>> emulators;
+    std::vector<std::unique_ptr<Deque>> deques;
+    std::vector<WorkerStats> workerStats;
+    std::vector<Job> jobs;                   //Submitted, not yet run
+    size_t nextJob = 0;                      //Index handed out by the next submit()
+    size_t firstJob = 0;                     //Index of jobs.front()
+    using Image = std::pair<std::string, Word>; //File and load address
+    std::map<Image, Memory> images;          //Loaded once, shared copy-on-write by every job
+    ResultQueue results;                     //Allocated once, poll() may run next to run()
+    std::mutex overflowLock;
+    std::vector<Result> overflow;            //Results that found the queue full
+
+    void work(unsigned worker);
+    bool steal(unsigned thief, size_t &job);
+    Result runJob(Emulator &emulator, unsigned worker, size_t job);
+};
+
+#endif //FARM_H
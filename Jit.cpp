@@ -0,0 +1,703 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Jit.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "CPU.h"
+#include "Decimal.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define EMU_JIT_SUPPORTED 1
+#endif
+
+namespace {
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+    // Context field offsets used by the generated code
+    constexpr Byte CTX_PAGES = 0, CTX_A = 16, CTX_X = 20, CTX_Y = 24, CTX_P = 28;
+    constexpr Byte CTX_PC = 32, CTX_CYCLES = 36, CTX_ABORT = 40, CTX_INSTRUCTIONS = 44;
+
+    static_assert(offsetof(Jit::Context, pages) == CTX_PAGES, "Context::pages moved");
+    static_assert(offsetof(Jit::Context, A) == CTX_A, "Context::A moved");
+    static_assert(offsetof(Jit::Context, X) == CTX_X, "Context::X moved");
+    static_assert(offsetof(Jit::Context, Y) == CTX_Y, "Context::Y moved");
+    static_assert(offsetof(Jit::Context, P) == CTX_P, "Context::P moved");
+    static_assert(offsetof(Jit::Context, pc) == CTX_PC, "Context::pc moved");
+    static_assert(offsetof(Jit::Context, cycles) == CTX_CYCLES, "Context::cycles moved");
+    static_assert(offsetof(Jit::Context, abort) == CTX_ABORT, "Context::abort moved");
+    static_assert(offsetof(Jit::Context, instructions) == CTX_INSTRUCTIONS, "Context::instructions moved");
+
+    enum Reg : Byte {RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15};
+
+    // Guest state in callee-saved registers, so helper calls keep it intact
+    constexpr Reg REG_A = RBX, REG_X = R12, REG_Y = R13, REG_P = RBP, REG_CTX = R14, REG_MEM = R15;
+
+    enum AluOp : Byte {ADD = 0x01, OR = 0x09, AND = 0x21, SUB = 0x29, XOR = 0x31};
+    enum AluExt : Byte {EXT_ADD = 0, EXT_OR = 1, EXT_AND = 4, EXT_SUB = 5, EXT_XOR = 6};
+
+    // Minimal x86-64 encoder, 32-bit operations unless noted
+    class Emitter {
+    public:
+        std::vector<Byte> out;
+        std::vector<size_t> epilogueJumps;
+
+        void byte(const Byte value) { out.push_back(value); }
+
+        void dword(const uint32_t value) {
+            for (int i = 0; i < 4; i++) byte(static_cast<Byte>(value >> (8 * i)));
+        }
+
+        void qword(const uint64_t value) {
+            for (int i = 0; i < 8; i++) byte(static_cast<Byte>(value >> (8 * i)));
+        }
+
+        void rex(const bool w, const Reg reg, const Reg rm, const bool force = false) {
+            const Byte prefix = 0x40 | (w << 3) | ((reg >= R8) << 2) | (rm >= R8);
+            if (prefix != 0x40 || force) byte(prefix);
+        }
+
+        void modrm(const Byte mod, const Byte reg, const Byte rm) {
+            byte(static_cast<Byte>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+        }
+
+        void movImm(const Reg dst, const uint32_t imm) {
+            rex(false, RAX, dst);
+            byte(0xB8 + (dst & 7));
+            dword(imm);
+        }
+
+        void alu(const AluOp op, const Reg dst, const Reg src) {
+            rex(false, src, dst);
+            byte(op);
+            modrm(3, src, dst);
+        }
+
+        void aluImm(const AluExt ext, const Reg dst, const uint32_t imm) {
+            rex(false, RAX, dst);
+            byte(0x81);
+            modrm(3, ext, dst);
+            dword(imm);
+        }
+
+        void mov(const Reg dst, const Reg src) { alu(static_cast<AluOp>(0x89), dst, src); }
+
+        void shr(const Reg dst, const Byte bits) {
+            rex(false, RAX, dst);
+            byte(0xC1);
+            modrm(3, 5, dst);
+            byte(bits);
+        }
+
+        void bitNot(const Reg dst) {
+            rex(false, RAX, dst);
+            byte(0xF7);
+            modrm(3, 2, dst);
+        }
+
+        void test(const Reg a, const Reg b) { alu(static_cast<AluOp>(0x85), a, b); }
+
+        void testImm(const Reg dst, const uint32_t imm) {
+            rex(false, RAX, dst);
+            byte(0xF7);
+            modrm(3, 0, dst);
+            dword(imm);
+        }
+
+        // mov dst, [REG_MEM + page * 8], the page's current host pointer
+        void loadPage(const Reg dst, const Byte page) {
+            rex(true, dst, REG_MEM);
+            byte(0x8B);
+            modrm(2, dst, REG_MEM);
+            dword(page * 8u);
+        }
+
+        // movzx dst, byte [page of addr + low byte], clobbers rax
+        void loadAbsolute(const Reg dst, const Word addr) {
+            loadPage(RAX, static_cast<Byte>(addr >> 8));
+            rex(false, dst, RAX);
+            byte(0x0F); byte(0xB6);
+            modrm(2, dst, RAX);
+            dword(addr & 0xFF);
+        }
+
+        // movzx dst, byte [zero page + rax], clobbers rdx
+        void loadIndexed(const Reg dst) {
+            loadPage(RDX, 0);
+            rex(false, dst, RDX);
+            byte(0x0F); byte(0xB6);
+            modrm(0, dst, 4);
+            byte(static_cast<Byte>((RAX << 3) | RDX));
+        }
+
+        void loadContext(const Reg dst, const Byte offset) {
+            rex(false, dst, REG_CTX);
+            byte(0x8B);
+            modrm(1, dst, REG_CTX);
+            byte(offset);
+        }
+
+        void storeContext(const Byte offset, const Reg src) {
+            rex(false, src, REG_CTX);
+            byte(0x89);
+            modrm(1, src, REG_CTX);
+            byte(offset);
+        }
+
+        void storeContextImm(const Byte offset, const uint32_t imm) {
+            rex(false, RAX, REG_CTX);
+            byte(0xC7);
+            modrm(1, 0, REG_CTX);
+            byte(offset);
+            dword(imm);
+        }
+
+        void push(const Reg reg) { rex(false, RAX, reg); byte(0x50 + (reg & 7)); }
+        void pop(const Reg reg) { rex(false, RAX, reg); byte(0x58 + (reg & 7)); }
+
+        // Sets N and Z of REG_P from a 0-255 value, clobbers rax
+        void setNZ(const Reg value) {
+            aluImm(EXT_AND, REG_P, 0x7D);
+            mov(RAX, value);
+            aluImm(EXT_AND, RAX, 0x80);
+            alu(OR, REG_P, RAX);
+            test(value, value);
+            byte(0x0F); byte(0x94); byte(0xC0);     //setz al
+            byte(0x0F); byte(0xB6); byte(0xC0);     //movzx eax, al
+            alu(ADD, RAX, RAX);
+            alu(OR, REG_P, RAX);
+        }
+
+        // Leaves the block with the given next PC and totals
+        void exit(const Word pc, const int cycles, const int instructions) {
+            storeContextImm(CTX_PC, pc);
+            storeContextImm(CTX_CYCLES, cycles);
+            storeContextImm(CTX_INSTRUCTIONS, instructions);
+            byte(0xE9);
+            epilogueJumps.push_back(out.size());
+            dword(0);
+        }
+
+        // jcc rel8 placeholder, returns the position to patch
+        size_t jumpShort(const Byte condition) {
+            byte(0x70 | condition);
+            byte(0);
+            return out.size() - 1;
+        }
+
+        void patchShort(const size_t position) {
+            out[position] = static_cast<Byte>(out.size() - position - 1);
+        }
+
+        // jmp rel32 placeholder, returns the position to patch
+        size_t jumpNear() {
+            byte(0xE9);
+            dword(0);
+            return out.size() - 4;
+        }
+
+        void patchNear(const size_t position) {
+            const auto rel = static_cast<uint32_t>(out.size() - position - 4);
+            std::memcpy(&out[position], &rel, 4);
+        }
+
+        void prologue() {
+            push(RBX); push(RBP); push(R12); push(R13); push(R14); push(R15);
+            byte(0x48); byte(0x83); byte(0xEC); byte(0x08);    //sub rsp, 8 (align calls)
+            byte(0x49); byte(0x89); byte(0xFE);                //mov r14, rdi
+            byte(0x4D); byte(0x8B); byte(0x3E);                //mov r15, [r14 + CTX_PAGES]
+            loadContext(REG_A, CTX_A);
+            loadContext(REG_X, CTX_X);
+            loadContext(REG_Y, CTX_Y);
+            loadContext(REG_P, CTX_P);
+        }
+
+        void epilogue() {
+            for (const size_t position : epilogueJumps) {
+                const auto rel = static_cast<uint32_t>(out.size() - position - 4);
+                std::memcpy(&out[position], &rel, 4);
+            }
+            storeContext(CTX_A, REG_A);
+            storeContext(CTX_X, REG_X);
+            storeContext(CTX_Y, REG_Y);
+            storeContext(CTX_P, REG_P);
+            byte(0x48); byte(0x83); byte(0xC4); byte(0x08);    //add rsp, 8
+            pop(R15); pop(R14); pop(R13); pop(R12); pop(RBP); pop(RBX);
+            byte(0xC3);
+        }
+    };
+
+    // Opens the pages under [begin, begin + size) for writing, or seals them
+    // read and execute again. The code buffer is never writable and executable at once.
+    bool protect(Byte* begin, const size_t size, const bool writable) {
+#ifdef EMU_JIT_SUPPORTED
+        const auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t first = reinterpret_cast<uintptr_t>(begin) & ~(pageSize - 1);
+        const uintptr_t end = reinterpret_cast<uintptr_t>(begin) + size;
+        return mprotect(reinterpret_cast<void*>(first), end - first,
+                        writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#else
+        return false;
+#endif
+    }
+
+    enum class Kind {LOAD, STORE, ADC, SBC, AND, ORA, EOR, CMP, INCREMENT, DECREMENT, SET, CLEAR, NOP, BRANCH, JMP};
+    enum class Mode {IMPLIED, IM, ZP, ZPX, ABS};
+
+    struct OpInfo {
+        Kind kind;
+        Mode mode;
+        Reg reg;        //Register loaded, stored, compared or stepped
+        Byte mask;      //Status bits for SET/CLEAR/BRANCH
+        bool whenSet;   //BRANCH taken when the masked bit is set
+    };
+
+    constexpr Byte FLAG_C = 0x01, FLAG_Z = 0x02, FLAG_I = 0x04, FLAG_D = 0x08, FLAG_V = 0x40, FLAG_N = 0x80;
+
+    // Opcodes the translator handles; the cycle costs below mirror the interpreter
+    bool describe(const Byte opcode, OpInfo &info) {
+        switch (opcode) {
+            case 0xA9: info = {Kind::LOAD, Mode::IM, REG_A}; return true;
+            case 0xA5: info = {Kind::LOAD, Mode::ZP, REG_A}; return true;
+            case 0xB5: info = {Kind::LOAD, Mode::ZPX, REG_A}; return true;
+            case 0xAD: info = {Kind::LOAD, Mode::ABS, REG_A}; return true;
+            case 0xA2: info = {Kind::LOAD, Mode::IM, REG_X}; return true;
+            case 0xA6: info = {Kind::LOAD, Mode::ZP, REG_X}; return true;
+            case 0xAE: info = {Kind::LOAD, Mode::ABS, REG_X}; return true;
+            case 0xA0: info = {Kind::LOAD, Mode::IM, REG_Y}; return true;
+            case 0xA4: info = {Kind::LOAD, Mode::ZP, REG_Y}; return true;
+            case 0xAC: info = {Kind::LOAD, Mode::ABS, REG_Y}; return true;
+
+            case 0x85: info = {Kind::STORE, Mode::ZP, REG_A}; return true;
+            case 0x8D: info = {Kind::STORE, Mode::ABS, REG_A}; return true;
+            case 0x86: info = {Kind::STORE, Mode::ZP, REG_X}; return true;
+            case 0x8E: info = {Kind::STORE, Mode::ABS, REG_X}; return true;
+            case 0x84: info = {Kind::STORE, Mode::ZP, REG_Y}; return true;
+            case 0x8C: info = {Kind::STORE, Mode::ABS, REG_Y}; return true;
+
+            case 0x69: info = {Kind::ADC, Mode::IM}; return true;
+            case 0x65: info = {Kind::ADC, Mode::ZP}; return true;
+            case 0x6D: info = {Kind::ADC, Mode::ABS}; return true;
+            case 0xE9: info = {Kind::SBC, Mode::IM}; return true;
+            case 0xE5: info = {Kind::SBC, Mode::ZP}; return true;
+            case 0xED: info = {Kind::SBC, Mode::ABS}; return true;
+            case 0x29: info = {Kind::AND, Mode::IM}; return true;
+            case 0x25: info = {Kind::AND, Mode::ZP}; return true;
+            case 0x2D: info = {Kind::AND, Mode::ABS}; return true;
+            case 0x09: info = {Kind::ORA, Mode::IM}; return true;
+            case 0x05: info = {Kind::ORA, Mode::ZP}; return true;
+            case 0x0D: info = {Kind::ORA, Mode::ABS}; return true;
+            case 0x49: info = {Kind::EOR, Mode::IM}; return true;
+            case 0x45: info = {Kind::EOR, Mode::ZP}; return true;
+            case 0x4D: info = {Kind::EOR, Mode::ABS}; return true;
+            case 0xC9: info = {Kind::CMP, Mode::IM, REG_A}; return true;
+            case 0xC5: info = {Kind::CMP, Mode::ZP, REG_A}; return true;
+            case 0xCD: info = {Kind::CMP, Mode::ABS, REG_A}; return true;
+            case 0xE0: info = {Kind::CMP, Mode::IM, REG_X}; return true;
+            case 0xC0: info = {Kind::CMP, Mode::IM, REG_Y}; return true;
+
+            case 0xC8: info = {Kind::INCREMENT, Mode::IMPLIED, REG_Y}; return true;
+            case 0x88: info = {Kind::DECREMENT, Mode::IMPLIED, REG_Y}; return true;
+
+            case 0x38: info = {Kind::SET, Mode::IMPLIED, RAX, FLAG_C}; return true;
+            case 0x18: info = {Kind::CLEAR, Mode::IMPLIED, RAX, FLAG_C}; return true;
+            case 0xB8: info = {Kind::CLEAR, Mode::IMPLIED, RAX, FLAG_V}; return true;
+            case 0xF8: info = {Kind::SET, Mode::IMPLIED, RAX, FLAG_D}; return true;
+            case 0xD8: info = {Kind::CLEAR, Mode::IMPLIED, RAX, FLAG_D}; return true;
+            case 0x78: info = {Kind::SET, Mode::IMPLIED, RAX, FLAG_I}; return true;
+            case 0x58: info = {Kind::CLEAR, Mode::IMPLIED, RAX, FLAG_I}; return true;
+            case 0xEA: info = {Kind::NOP, Mode::IMPLIED}; return true;
+
+            case 0x10: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_N, false}; return true;
+            case 0x30: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_N, true}; return true;
+            case 0x50: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_V, false}; return true;
+            case 0x70: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_V, true}; return true;
+            case 0x90: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_C, false}; return true;
+            case 0xB0: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_C, true}; return true;
+            case 0xD0: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_Z, false}; return true;
+            case 0xF0: info = {Kind::BRANCH, Mode::IM, RAX, FLAG_Z, true}; return true;
+            case 0x4C: info = {Kind::JMP, Mode::ABS}; return true;
+
+            default: return false;
+        }
+    }
+
+    Byte operandBytes(const OpInfo &info) {
+        switch (info.mode) {
+            case Mode::IMPLIED: return 0;
+            case Mode::ABS: return 2;
+            default: return 1;
+        }
+    }
+
+    // Loads the operand value of a read instruction into rcx
+    void emitOperand(Emitter &e, const Mode mode, const Word operand) {
+        switch (mode) {
+            case Mode::IM:
+                e.movImm(RCX, operand); break;
+            case Mode::ZPX:
+                e.mov(RAX, REG_X);
+                e.aluImm(EXT_ADD, RAX, operand);
+                e.aluImm(EXT_AND, RAX, 0xFF);
+                e.loadIndexed(RCX); break;
+            default:
+                e.loadAbsolute(RCX, operand); break;
+        }
+    }
+}
+
+bool Jit::available() {
+#ifdef EMU_JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+Jit::Jit(Memory &memory)
+    : mem(&memory), layout(memory.layout()), blockAt(65536, -1), heat(65536, 0) {
+#ifdef EMU_JIT_SUPPORTED
+    void* buffer = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_EXEC,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code = buffer == MAP_FAILED ? nullptr : static_cast<Byte*>(buffer);
+#endif
+    mem->attachWatcher(this);
+}
+
+Jit::~Jit() {
+    if (mem) {
+        mem->attachWatcher(nullptr);
+    }
+#ifdef EMU_JIT_SUPPORTED
+    if (code) {
+        munmap(code, CODE_SIZE);
+    }
+#endif
+}
+
+bool Jit::isHot(const Word pc) {
+    if (!code || heat[pc] == NEVER_COMPILE) {
+        return false;
+    }
+    return ++heat[pc] >= HOT_THRESHOLD;
+}
+
+Jit::Block* Jit::compile(const Word pc) {
+    Emitter e;
+    e.prologue();
+
+    Word addr = pc;
+    int cycles = 0;
+    int cyclesBeforeLast = 0;
+    int count = 0;
+    bool terminated = false;
+    OpInfo info{};
+
+    // With D set ADC/SBC (value in rcx) go through Jit::decimal instead of the
+    // binary code that follows, the returned jump skips that code
+    const auto decimal = [&e](const bool subtract) {
+        e.testImm(REG_P, FLAG_D);
+        const size_t binary = e.jumpShort(0x4);    //je
+        e.mov(RDI, REG_A);
+        e.mov(RSI, RCX);
+        e.mov(RDX, REG_P);
+        e.movImm(RCX, subtract);
+        e.byte(0x48); e.byte(0xB8);                //mov rax, imm64
+        e.qword(reinterpret_cast<uint64_t>(&Jit::decimal));
+        e.byte(0xFF); e.byte(0xD0);                //call rax
+        e.mov(REG_P, RAX);
+        e.shr(REG_P, 8);
+        e.aluImm(EXT_AND, RAX, 0xFF);
+        e.mov(REG_A, RAX);
+        const size_t done = e.jumpNear();
+        e.patchShort(binary);
+        return done;
+    };
+
+    Byte* const* pages = mem->pageTable();
+    while (count < static_cast<int>(MAX_BLOCK_OPS) && pages[addr >> 8] && describe(mem->readByte(addr), info)) {
+        const Byte opcode = mem->readByte(addr);
+        const Byte bytes = operandBytes(info);
+        if (addr + 1 + bytes > 0xFFFF || !pages[(addr + bytes) >> 8]) {
+            break; //Keep blocks from wrapping around memory or running into a device
+        }
+        Word operand = 0;
+        if (bytes == 1) {
+            operand = mem->readByte(static_cast<Word>(addr + 1));
+        } else if (bytes == 2) {
+            operand = mem->readByte(static_cast<Word>(addr + 1)) | (mem->readByte(static_cast<Word>(addr + 2)) << 8);
+        }
+        const bool reads = info.kind != Kind::STORE && info.kind != Kind::JMP && info.mode != Mode::IM &&
+                           info.mode != Mode::IMPLIED;
+        if (reads && !pages[info.mode == Mode::ABS ? operand >> 8 : 0]) {
+            break; //Device reads stay with the interpreter, native loads index host pages directly
+        }
+        const Word next = addr + 1 + bytes;
+        cyclesBeforeLast = cycles;
+        cycles += Cpu::baseCycles[opcode]; //None of the compiled modes can cross a page
+
+        switch (info.kind) {
+            case Kind::LOAD:
+                emitOperand(e, info.mode, operand);
+                e.mov(info.reg, RCX);
+                e.setNZ(info.reg);
+                break;
+            case Kind::STORE: {
+                e.byte(0x4C); e.byte(0x89); e.byte(0xF7);  //mov rdi, r14
+                e.movImm(RSI, operand);
+                e.mov(RDX, info.reg);
+                e.byte(0x48); e.byte(0xB8);                //mov rax, imm64
+                e.qword(reinterpret_cast<uint64_t>(&Jit::write));
+                e.byte(0xFF); e.byte(0xD0);                //call rax
+                e.rex(false, RAX, REG_CTX);                //cmp dword [r14 + abort], 0
+                e.byte(0x83); e.modrm(1, 7, REG_CTX); e.byte(CTX_ABORT); e.byte(0);
+                const size_t skip = e.jumpShort(0x4);      //je
+                e.exit(next, cycles, count + 1);
+                e.patchShort(skip);
+                break;
+            }
+            case Kind::ADC: {
+                emitOperand(e, info.mode, operand);
+                const size_t done = decimal(false);
+                e.mov(RAX, REG_P);
+                e.aluImm(EXT_AND, RAX, FLAG_C);
+                e.alu(ADD, RAX, REG_A);
+                e.alu(ADD, RAX, RCX);                      //eax = A + value + C
+                e.mov(RDX, RAX);
+                e.shr(RDX, 8);                             //Carry out
+                e.mov(RSI, REG_A);
+                e.alu(XOR, RSI, RCX);
+                e.bitNot(RSI);
+                e.mov(RDI, REG_A);
+                e.alu(XOR, RDI, RAX);
+                e.alu(AND, RSI, RDI);
+                e.aluImm(EXT_AND, RSI, 0x80);
+                e.shr(RSI, 1);                             //Overflow into bit 6
+                e.aluImm(EXT_AND, REG_P, 0xFF & ~(FLAG_C | FLAG_V));
+                e.alu(OR, REG_P, RDX);
+                e.alu(OR, REG_P, RSI);
+                e.aluImm(EXT_AND, RAX, 0xFF);
+                e.mov(REG_A, RAX);
+                e.setNZ(REG_A);
+                e.patchNear(done);
+                break;
+            }
+            case Kind::SBC: {
+                emitOperand(e, info.mode, operand);
+                const size_t done = decimal(true);
+                e.mov(RAX, REG_A);
+                e.alu(SUB, RAX, RCX);
+                e.aluImm(EXT_SUB, RAX, 1);
+                e.mov(RDX, REG_P);
+                e.aluImm(EXT_AND, RDX, FLAG_C);
+                e.alu(ADD, RAX, RDX);                      //eax = A - value - (1 - C)
+                e.mov(RDX, RAX);
+                e.shr(RDX, 31);
+                e.aluImm(EXT_XOR, RDX, 1);                 //Carry = no borrow
+                e.aluImm(EXT_AND, RAX, 0xFF);
+                e.mov(RSI, REG_A);
+                e.alu(XOR, RSI, RCX);
+                e.mov(RDI, REG_A);
+                e.alu(XOR, RDI, RAX);
+                e.alu(AND, RSI, RDI);
+                e.aluImm(EXT_AND, RSI, 0x80);
+                e.shr(RSI, 1);
+                e.aluImm(EXT_AND, REG_P, 0xFF & ~(FLAG_C | FLAG_V));
+                e.alu(OR, REG_P, RDX);
+                e.alu(OR, REG_P, RSI);
+                e.mov(REG_A, RAX);
+                e.setNZ(REG_A);
+                e.patchNear(done);
+                break;
+            }
+            case Kind::AND:
+            case Kind::ORA:
+            case Kind::EOR:
+                emitOperand(e, info.mode, operand);
+                e.alu(info.kind == Kind::AND ? AND : info.kind == Kind::ORA ? OR : XOR, REG_A, RCX);
+                e.setNZ(REG_A);
+                break;
+            case Kind::CMP:
+                emitOperand(e, info.mode, operand);
+                e.mov(RAX, info.reg);
+                e.alu(SUB, RAX, RCX);
+                e.mov(RDX, RAX);
+                e.shr(RDX, 31);
+                e.aluImm(EXT_XOR, RDX, 1);                 //Carry = reg >= value
+                e.aluImm(EXT_AND, RAX, 0xFF);
+                e.mov(RSI, RAX);
+                e.aluImm(EXT_AND, REG_P, 0xFF & ~FLAG_C);
+                e.alu(OR, REG_P, RDX);
+                e.setNZ(RSI);
+                break;
+            case Kind::INCREMENT:
+            case Kind::DECREMENT:
+                e.aluImm(info.kind == Kind::INCREMENT ? EXT_ADD : EXT_SUB, info.reg, 1);
+                e.aluImm(EXT_AND, info.reg, 0xFF);
+                e.setNZ(info.reg);
+                break;
+            case Kind::SET:
+                e.aluImm(EXT_OR, REG_P, info.mask);
+                break;
+            case Kind::CLEAR:
+                e.aluImm(EXT_AND, REG_P, 0xFF & ~info.mask);
+                break;
+            case Kind::NOP:
+                break;
+            case Kind::BRANCH: {
+                // Same target and page-cross rule as Cpu::branch
+                const auto target = static_cast<Word>(next + static_cast<int8_t>(operand) - 1);
+                const int taken = cycles + ((next & 0xFF00) != (target & 0xFF00) ? 2 : 1);
+                e.testImm(REG_P, info.mask);
+                const size_t notTaken = e.jumpShort(info.whenSet ? 0x4 : 0x5);   //je / jne
+                e.exit(target, taken, count + 1);
+                e.patchShort(notTaken);
+                e.exit(next, cycles, count + 1);
+                terminated = true;
+                break;
+            }
+            case Kind::JMP:
+                e.exit(operand, cycles, count + 1);
+                terminated = true;
+                break;
+        }
+
+        addr = next;
+        count++;
+        if (terminated) {
+            break;
+        }
+    }
+
+    if (count == 0) {
+        heat[pc] = NEVER_COMPILE;
+        return nullptr;
+    }
+    if (!terminated) {
+        e.exit(addr, cycles, count);
+    }
+    e.epilogue();
+
+    if (codeUsed + e.out.size() > CODE_SIZE) {
+        flush();
+    }
+    Byte* target = code + codeUsed;
+    if (!protect(target, e.out.size(), true)) {
+        heat[pc] = NEVER_COMPILE;
+        return nullptr;
+    }
+    std::memcpy(target, e.out.data(), e.out.size());
+    if (!protect(target, e.out.size(), false)) {
+        heat[pc] = NEVER_COMPILE; //Left writable, so it must never run
+        return nullptr;
+    }
+    codeUsed += (e.out.size() + 15) & ~static_cast<size_t>(15);
+
+    const auto index = static_cast<int32_t>(blocks.size());
+    blocks.push_back({reinterpret_cast<void (*)(Context*)>(target), pc, static_cast<Word>(addr - pc),
+                      cyclesBeforeLast, true});
+    blockAt[pc] = index;
+
+    const Byte firstPage = pc >> 8;
+    const Byte lastPage = static_cast<Word>(addr - 1) >> 8;
+    for (Byte page = firstPage; ; page++) {
+        pageBlocks[page].push_back(index);
+        mem->watchPage(page, true);
+        if (page == lastPage) break;
+    }
+    return &blocks[index];
+}
+
+void Jit::run(Block &block, Context &context) {
+    context.pages = mem->pageTable();
+    context.mem = mem;
+    context.abort = 0;
+    running = &block;
+    runningContext = &context;
+    block.code(&context);
+    running = nullptr;
+    runningContext = nullptr;
+}
+
+void Jit::write(Context *context, const uint32_t addr, const uint32_t value) {
+    context->mem->writeByte(static_cast<Word>(addr), static_cast<Byte>(value));
+}
+
+// ADC/SBC with D set, returns the new A | P << 8. Flags as Cpu::ADC/SBC set them.
+uint32_t Jit::decimal(const uint32_t a, const uint32_t value, const uint32_t p, const uint32_t subtract) {
+    const bool carry = p & FLAG_C;
+    uint32_t status = p & (0xFF & ~(FLAG_C | FLAG_Z | FLAG_V | FLAG_N));
+    uint32_t result;
+    if (subtract) {
+        const uint32_t binary = a + (~value & 0xFF) + carry;
+        result = Decimal::subtract(static_cast<Byte>(a), static_cast<Byte>(value), carry);
+        status |= binary >> 8 | ((binary & 0xFF) == 0 ? FLAG_Z : 0) | (binary & FLAG_N) |
+                  ((a ^ value) & (a ^ binary) & 0x80) >> 1;
+    } else {
+        const uint16_t sum = Decimal::add(static_cast<Byte>(a), static_cast<Byte>(value), carry);
+        const uint32_t sign = (sum >> 8) & 0x80;
+        result = sum & 0xFF;
+        status |= (sum >> 8 & FLAG_C) | (((a + value + carry) & 0xFF) == 0 ? FLAG_Z : 0) | sign |
+                  (~(a ^ value) & (a ^ sign) & 0x80) >> 1;
+    }
+    return result | status << 8;
+}
+
+void Jit::flush() {
+    for (std::vector<int32_t> &list : pageBlocks) {
+        list.clear();
+    }
+    for (const Block &block : blocks) {
+        blockAt[block.start] = -1;
+    }
+    blocks.clear();
+    std::fill(heat.begin(), heat.end(), 0);
+    codeUsed = 0;
+    if (mem) {
+        for (int page = 0; page < 256; page++) {
+            mem->watchPage(static_cast<Byte>(page), false);
+        }
+        layout = mem->layout();
+    }
+}
+
+void Jit::memoryDetached() {
+    mem = nullptr;
+}
+
+void Jit::memoryWritten(const uint16_t addr) {
+    const std::vector<int32_t> &candidates = pageBlocks[addr >> 8];
+    for (size_t i = candidates.size(); i-- > 0; ) {
+        const int32_t index = candidates[i];
+        const Block &block = blocks[index];
+        if (block.valid && static_cast<Word>(addr - block.start) < block.size) {
+            invalidate(index);
+        }
+    }
+}
+
+void Jit::invalidate(const int32_t index) {
+    Block &block = blocks[index];
+    block.valid = false;
+    blockAt[block.start] = -1;
+    heat[block.start] = 0;
+    if (running == &block) {
+        runningContext->abort = 1;
+    }
+
+    const Byte firstPage = block.start >> 8;
+    const Byte lastPage = static_cast<Word>(block.start + block.size - 1) >> 8;
+    for (Byte page = firstPage; ; page++) {
+        std::vector<int32_t> &list = pageBlocks[page];
+        list.erase(std::remove(list.begin(), list.end(), index), list.end());
+        if (list.empty() && mem) {
+            mem->watchPage(page, false);
+        }
+        if (page == lastPage) break;
+    }
+}
@@ -0,0 +1,97 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+
+// x86-64 translator for hot basic blocks. Only opcodes with a fixed cycle cost
+// are translated; a block stops in front of the first one it cannot handle and
+// the interpreter carries on from there. A/X/Y and the status byte live in host
+// registers while a block runs, stores go through Memory::writeByte so watched
+// pages still see them. ADC/SBC test D at run time and call out to the
+// decimal tables when it is set.
+class Jit final : public MemoryWatcher {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    // Shared with the generated code, offsets are hardcoded (and static_asserted) in Jit.cpp
+    struct Context {
+        Byte* const* pages;    //Memory::pageTable, reread on every load
+        Memory* mem;
+        uint32_t A, X, Y, P;   //P as pushed by PHP
+        uint32_t pc;           //Next PC when the block exits
+        uint32_t cycles;       //Cycles spent by the block
+        uint32_t abort;        //Set when a store overwrote the running block
+        uint32_t instructions; //Instructions retired by the block
+    };
+
+    struct Block {
+        void (*code)(Context* context);
+        Word start;
+        Word size;
+        int cyclesBeforeLast;  //Budget the interpreter needs left to reach the last instruction
+        bool valid;
+    };
+
+    static constexpr int HOT_THRESHOLD = 16;
+    static constexpr size_t MAX_BLOCK_OPS = 64;
+
+    [[nodiscard]] static bool available();
+
+    explicit Jit(Memory &memory);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit &operator=(const Jit&) = delete;
+
+    // False once the Memory it watched is gone or detached it
+    [[nodiscard]] bool boundTo(const Memory &memory) const { return mem == &memory; }
+
+    [[nodiscard]] Block* find(const Word pc) {
+        if (layout != mem->layout()) [[unlikely]] {
+            flush(); //A device moved, blocks may read its pages directly
+        }
+        const int32_t index = blockAt[pc];
+        return index < 0 ? nullptr : &blocks[index];
+    }
+
+    // Counts one more entry into pc, true once it is worth compiling
+    bool isHot(Word pc);
+    Block* compile(Word pc);
+    void run(Block &block, Context &context);
+    void flush();
+
+    void memoryWritten(uint16_t addr) override;
+    void memoryDetached() override;
+
+private:
+    static constexpr Byte NEVER_COMPILE = 0xFF;
+    static constexpr size_t CODE_SIZE = 8 * 1024 * 1024;
+
+    Memory* mem;                              //Null once detached
+    Byte* code = nullptr;                     //Executable buffer, bump allocated, writable only while a block is copied in
+    size_t codeUsed = 0;
+    uint32_t layout = 0;                      //Memory::layout the blocks were compiled against
+
+    std::vector<int32_t> blockAt;             //Start address -> index into blocks
+    std::vector<Byte> heat;                   //Entries seen by the interpreter per address
+    std::vector<Block> blocks;
+    std::vector<int32_t> pageBlocks[256];
+
+    Block* running = nullptr;
+    Context* runningContext = nullptr;
+
+    void invalidate(int32_t index);
+    static void write(Context* context, uint32_t addr, uint32_t value);
+    static uint32_t decimal(uint32_t a, uint32_t value, uint32_t p, uint32_t subtract);
+};
+
+#endif //JIT_H
@@ -0,0 +1,242 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace {
+    enum Kind : uint8_t {NONE, HEX, TEXT};
+
+    struct Entry {
+        uint64_t cycles = 0;
+        int64_t time = 0;                       //Seconds since the epoch, from the cached clock
+        const char* message = nullptr;          //Null when ownedMessage holds it
+        Log::Level level = Log::INFO;
+        Kind kind = NONE;
+        uint16_t number = 0;
+        std::string ownedMessage;
+        std::string text;                       //Strings are moved in, not copied
+    };
+
+    // Bounded multi-producer ring after Vyukov: a slot's sequence says whose
+    // turn it is, so producers only contend on the enqueue counter and the
+    // writer thread never touches it.
+    class Logger {
+    public:
+        static Logger &instance() {
+            static Logger logger;
+            return logger;
+        }
+
+        template<typename Fill>
+        void push(const uint64_t cycles, const Log::Level level, Fill &&fill) {
+            uint64_t position = enqueuePos.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &slots[position & (CAPACITY - 1)];
+                const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+                if (sequence == position) {
+                    if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (sequence < position) {
+                    droppedCount.fetch_add(1, std::memory_order_relaxed); //Full, the writer is behind
+                    return;
+                } else {
+                    position = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            Entry &entry = slot->entry;
+            entry.cycles = cycles;
+            entry.time = clock.load(std::memory_order_relaxed);
+            entry.level = level;
+            entry.message = nullptr;
+            entry.kind = NONE;
+            fill(entry);
+            slot->sequence.store(position + 1, std::memory_order_release);
+        }
+
+        void flush() {
+            const uint64_t target = enqueuePos.load(std::memory_order_acquire);
+            while (written.load(std::memory_order_acquire) < target) {
+                std::this_thread::yield();
+            }
+        }
+
+        std::atomic<std::FILE*> output{stderr};
+        std::atomic<uint64_t> droppedCount{0};
+
+    private:
+        static constexpr uint64_t CAPACITY = 1 << 14;
+        static constexpr size_t BATCH = 256;    //Formatted per write
+
+        struct Slot {
+            std::atomic<uint64_t> sequence;
+            Entry entry;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        alignas(64) std::atomic<uint64_t> enqueuePos{0};
+        alignas(64) std::atomic<int64_t> clock{0};
+        std::atomic<uint64_t> written{0};       //Entries the writer is done with
+        std::atomic<bool> stopping{false};
+        std::thread writer;
+
+        //Writer only
+        uint64_t dequeuePos = 0;
+        uint64_t reportedDrops = 0;
+        int64_t formattedSecond = -1;
+        std::string formattedTime;
+        std::string buffer;
+
+        Logger() : slots(std::make_unique<Slot[]>(CAPACITY)) {
+            for (uint64_t i = 0; i < CAPACITY; i++) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            tick();
+            writer = std::thread(&Logger::run, this);
+        }
+
+        ~Logger() {
+            stopping.store(true, std::memory_order_release);
+            writer.join();
+        }
+
+        void tick() {
+            clock.store(std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count(),
+                        std::memory_order_relaxed);
+        }
+
+        // Same layout as ctime(), worked out once per second
+        const std::string &timeOf(const int64_t seconds) {
+            if (seconds != formattedSecond) {
+                const auto time = static_cast<std::time_t>(seconds);
+                char text[32];
+                std::strftime(text, sizeof(text), "%a %b %e %H:%M:%S %Y", std::localtime(&time));
+                formattedTime = text;
+                formattedSecond = seconds;
+            }
+            return formattedTime;
+        }
+
+        void format(const Entry &entry) {
+            static constexpr const char* tags[] = {
+                "[DEBUG]   ", "[INFO]    ", "[SUCCESS] ", "[WARNING] ", "[ERROR]   ", "[MESSAGE] "
+            };
+            buffer += '[';
+            buffer += std::to_string(entry.cycles);
+            buffer += "][";
+            buffer += timeOf(entry.time);
+            buffer += ']';
+            buffer += tags[entry.level];
+            buffer += entry.message ? entry.message : entry.ownedMessage.c_str();
+            if (entry.kind == HEX) {
+                static constexpr char digits[] = "0123456789ABCDEF";
+                char hex[8] = " 0x";
+                int length = 3;
+                int shift = 12;
+                while (shift > 0 && (entry.number >> shift) == 0) {
+                    shift -= 4;
+                }
+                for (; shift >= 0; shift -= 4) {
+                    hex[length++] = digits[(entry.number >> shift) & 0xF];
+                }
+                buffer.append(hex, length);
+            } else if (entry.kind == TEXT) {
+                buffer += ' ';
+                buffer += entry.text;
+            }
+            buffer += '\n';
+        }
+
+        bool pop() {
+            Slot &slot = slots[dequeuePos & (CAPACITY - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+                return false;
+            }
+            format(slot.entry);
+            slot.sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+            dequeuePos++;
+            return true;
+        }
+
+        void run() {
+            while (true) {
+                const bool last = stopping.load(std::memory_order_acquire);
+                tick();
+                size_t count = 0;
+                while (count < BATCH && pop()) {
+                    count++;
+                }
+                if (const uint64_t drops = droppedCount.load(std::memory_order_relaxed); drops != reportedDrops) {
+                    buffer += "[0][" + timeOf(clock.load(std::memory_order_relaxed)) + "][WARNING] Log full, messages dropped: " +
+                              std::to_string(drops - reportedDrops) + "\n";
+                    reportedDrops = drops;
+                }
+                if (!buffer.empty()) {
+                    std::FILE* file = output.load(std::memory_order_relaxed);
+                    std::fwrite(buffer.data(), 1, buffer.size(), file);
+                    std::fflush(file);
+                    buffer.clear();
+                }
+                written.store(dequeuePos, std::memory_order_release);
+
+                if (count == 0) {
+                    if (last) {
+                        return; //Everything logged before the destructor ran is out
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
+    };
+}
+
+void Log::write(const uint64_t cycles, const Level level, const char *message) {
+    Logger::instance().push(cycles, level, [&](Entry &entry) {
+        entry.message = message;
+    });
+}
+
+void Log::write(const uint64_t cycles, const Level level, const char *message, const uint16_t hex) {
+    Logger::instance().push(cycles, level, [&](Entry &entry) {
+        entry.message = message;
+        entry.kind = HEX;
+        entry.number = hex;
+    });
+}
+
+void Log::write(const uint64_t cycles, const Level level, const char *message, std::string value) {
+    Logger::instance().push(cycles, level, [&](Entry &entry) {
+        entry.message = message;
+        entry.kind = TEXT;
+        entry.text = std::move(value);
+    });
+}
+
+void Log::write(const uint64_t cycles, const Level level, std::string message, std::string value) {
+    Logger::instance().push(cycles, level, [&](Entry &entry) {
+        entry.ownedMessage = std::move(message);
+        entry.kind = TEXT;
+        entry.text = std::move(value);
+    });
+}
+
+void Log::flush() {
+    Logger::instance().flush();
+}
+
+void Log::setOutput(std::FILE *file) {
+    Logger::instance().output.store(file, std::memory_order_relaxed);
+}
+
+uint64_t Log::dropped() {
+    return Logger::instance().droppedCount.load(std::memory_order_relaxed);
+}
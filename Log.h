@@ -0,0 +1,42 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Set by CMake (EMU_LOG_LEVEL), everything is compiled in without it
+#ifndef EMU_LOG_LEVEL
+#define EMU_LOG_LEVEL DEBUG
+#endif
+
+// Asynchronous log behind Emulator::log. A call captures its arguments as they
+// are (a pointer to the literal message, the raw number, a moved string) into
+// a lock-free ring and returns; a background thread formats and writes them.
+// Time comes from a clock that thread keeps cached, so the caller never asks
+// the OS. With the ring full a message is dropped and counted, never waited
+// for. Levels below EMU_LOG_LEVEL (CMake) are compiled out, since every call
+// passes its level as a constant.
+class Log {
+public:
+    enum Level : uint8_t {DEBUG, INFO, SUCCESS, WARNING, ERROR, OFF}; //By severity
+
+    static constexpr Level minimum = EMU_LOG_LEVEL;
+    static constexpr bool enabled(const Level level) { return level >= minimum && level != OFF; }
+
+    // message must outlive the log, i.e. be a literal
+    static void write(uint64_t cycles, Level level, const char* message);
+    static void write(uint64_t cycles, Level level, const char* message, uint16_t hex); //Printed as 0x1F
+    static void write(uint64_t cycles, Level level, const char* message, std::string value);
+    static void write(uint64_t cycles, Level level, std::string message, std::string value);
+
+    static void flush();                   //Blocks until everything logged so far is written
+    static void setOutput(std::FILE* file); //stderr by default
+    [[nodiscard]] static uint64_t dropped();
+};
+
+#endif //LOG_H
@@ -3,32 +3,242 @@
 //
 
 #include "Memory.h"
+#include <algorithm>
+#include <cstring>
 using Byte = unsigned char;
 using Word = unsigned short;
 
+void Memory::map(const std::shared_ptr<Byte[]> &block) {
+    for (uint32_t page = 0; page < PAGES; page++) {
+        frames[page] = std::shared_ptr<Byte[]>(block, block.get() + page * PAGE_SIZE);
+        pageFlags[page] &= ~SHARED;
+        remap(page);
+    }
+}
+
+void Memory::unshare(const Byte page) {
+    std::shared_ptr<Byte[]> frame(new Byte[PAGE_SIZE]);
+    std::memcpy(frame.get(), ram(page), PAGE_SIZE);
+    frames[page] = std::move(frame);
+    pageFlags[page] &= ~SHARED;
+    remap(page);
+}
+
+void Memory::markDirty(const Byte page) {
+    if (pageFlags[page] & TRACKED) {
+        dirtyPages[page >> 6] |= uint64_t{1} << (page & 63);
+        pageFlags[page] &= ~TRACKED;
+    }
+}
+
+void Memory::touch(const Byte page) {
+    if (pageFlags[page] & SHARED) {
+        unshare(page);
+    }
+    markDirty(page);
+}
+
+void Memory::writeSlow(const Word addr, const Byte value) {
+    const Byte page = addr >> 8;
+    if (pageFlags[page] & DEVICE) {
+        handlers[page]->write(addr, value);
+        return;
+    }
+    touch(page);
+    pages[page][addr & 0xFF] = value;
+    if (pageFlags[page] & WATCHED) {
+        watcher->memoryWritten(addr);
+    }
+}
+
+Byte Memory::readDevice(const Word addr) const {
+    return handlers[addr >> 8]->read(addr);
+}
+
+void Memory::mapDevice(const Byte first, const uint32_t count, MemoryHandler* handler) {
+    for (uint32_t page = first; page < std::min(first + count, PAGES); page++) {
+        devices += (handler != nullptr) - (handlers[page] != nullptr);
+        handlers[page] = handler;
+        if (handler) {
+            pageFlags[page] |= DEVICE;
+        } else {
+            pageFlags[page] &= ~DEVICE;
+        }
+        remap(static_cast<Byte>(page));
+    }
+    layoutVersion++;
+}
+
 void Memory::clear() {
-    for (unsigned char & i : Data) {
-        i = 0x69;
+    track(0);
+    if (!pinned) {
+        map(std::shared_ptr<Byte[]>(new Byte[MAXMEM]));
+    }
+    for (uint32_t page = 0; page < PAGES; page++) {
+        std::memset(ram(static_cast<Byte>(page)), 0x69, PAGE_SIZE);
+    }
+}
+
+void Memory::share() const {
+    if (pinned) {
+        return;
+    }
+    for (Byte &flags : pageFlags) {
+        if (!(flags & SHARED)) {
+            flags |= SHARED;
+        }
     }
 }
 
 Byte Memory::operator[](Word byte) const {
-    return Data[byte];
+    return readByte(byte);
 }
 
 Byte &Memory::operator[](Word byte) {
-    return Data[byte];
+    touch(byte >> 8);
+    return ram(byte >> 8)[byte & 0xFF];
+}
+
+// Whole pages point straight into bytes and stay shared until written, the
+// partial pages at either end are copied. Anything past $FFFF is dropped.
+void Memory::mapShared(const Word addr, const std::shared_ptr<Byte[]> &bytes, uint32_t length) {
+    length = std::min(length, MAXMEM - addr);
+    uint32_t offset = 0;
+    while (offset < length) {
+        const uint32_t target = addr + offset;
+        const auto page = static_cast<Byte>(target >> 8);
+        const uint32_t within = target & 0xFF;
+        const uint32_t count = std::min(PAGE_SIZE - within, length - offset);
+        if (count == PAGE_SIZE) {
+            replacePage(page, std::shared_ptr<Byte[]>(bytes, bytes.get() + offset));
+        } else {
+            touch(page);
+            std::memcpy(ram(page) + within, bytes.get() + offset, count);
+            if (pageFlags[page] & WATCHED) {
+                for (uint32_t i = 0; i < count; i++) {
+                    watcher->memoryWritten(static_cast<uint16_t>(target + i));
+                }
+            }
+        }
+        markDirty(page);
+        offset += count;
+    }
 }
 
 Byte Memory::readByte(const Word &addr, int &cycles) const {
     cycles--;
-    return Data[addr];
+    return readByte(addr);
+}
+
+void Memory::attachWatcher(MemoryWatcher *memoryWatcher) {
+    if (watcher != nullptr && memoryWatcher != nullptr && watcher != memoryWatcher) {
+        watcher->memoryDetached();
+    }
+    watcher = memoryWatcher;
+    for (Byte &flags : pageFlags) {
+        flags &= ~WATCHED;
+    }
 }
 
-void Memory::writeByte(const Word &addr, Byte value) {
-    Data[addr] = value;
-};
+void Memory::watchPage(const Byte page, const bool watched) {
+    if (watched && watcher != nullptr) {
+        pageFlags[page] |= WATCHED;
+    } else {
+        pageFlags[page] &= ~WATCHED;
+    }
+}
 
 Memory::Memory() {
     clear();
 }
+
+Memory::Memory(Byte* storage) : storage(storage), pinned(true) {
+    for (uint32_t page = 0; page < PAGES; page++) {
+        remap(static_cast<Byte>(page));
+    }
+    clear();
+}
+
+Memory::Memory(const Memory &other) {
+    *this = other;
+}
+
+Memory::~Memory() {
+    if (watcher != nullptr) {
+        watcher->memoryDetached();
+    }
+}
+
+Memory &Memory::operator=(const Memory &other) {
+    if (this == &other) {
+        return *this;
+    }
+    track(0);
+    devices = other.devices;
+    layoutVersion++;
+    for (uint32_t page = 0; page < PAGES; page++) {
+        handlers[page] = other.handlers[page];
+        pageFlags[page] = (pageFlags[page] & ~DEVICE) | (other.pageFlags[page] & DEVICE);
+    }
+    if (pinned || other.pinned) {
+        //Pinned pages never move, so they are copied rather than shared
+        if (!pinned) {
+            map(std::shared_ptr<Byte[]>(new Byte[MAXMEM]));
+        }
+        for (uint32_t page = 0; page < PAGES; page++) {
+            std::memcpy(ram(static_cast<Byte>(page)), other.ram(static_cast<Byte>(page)), PAGE_SIZE);
+            remap(static_cast<Byte>(page));
+        }
+    } else {
+        other.share();
+        for (uint32_t page = 0; page < PAGES; page++) {
+            frames[page] = other.frames[page];
+            pageFlags[page] |= SHARED;
+            remap(static_cast<Byte>(page));
+        }
+    }
+    //Every page may hold other bytes now, code decoded from them is stale
+    for (uint32_t page = 0; page < PAGES; page++) {
+        pageReplaced(static_cast<Byte>(page));
+    }
+    return *this;
+}
+
+void Memory::track(const uint64_t snapshot) {
+    baseline = snapshot;
+    for (uint64_t &bits : dirtyPages) {
+        bits = 0;
+    }
+    for (Byte &flags : pageFlags) {
+        flags = snapshot ? flags | TRACKED : flags & ~TRACKED;
+    }
+}
+
+std::shared_ptr<Byte[]> Memory::sharePage(const Byte page) const {
+    if (pinned) {
+        std::shared_ptr<Byte[]> frame(new Byte[PAGE_SIZE]);
+        std::memcpy(frame.get(), ram(page), PAGE_SIZE);
+        return frame;
+    }
+    pageFlags[page] |= SHARED;
+    return frames[page];
+}
+
+void Memory::replacePage(const Byte page, const std::shared_ptr<Byte[]> &frame) {
+    if (pinned) {
+        std::memcpy(ram(page), frame.get(), PAGE_SIZE);
+    } else {
+        frames[page] = frame;
+        pageFlags[page] |= SHARED;
+        remap(page);
+    }
+    pageReplaced(page);
+}
+
+void Memory::pageReplaced(const Byte page) {
+    if (pageFlags[page] & WATCHED) {
+        for (uint32_t offset = 0; offset < PAGE_SIZE; offset++) {
+            watcher->memoryWritten(static_cast<uint16_t>(page * PAGE_SIZE + offset));
+        }
+    }
+}
@@ -5,22 +5,115 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 #include <cstdint>
+#include <memory>
+class Snapshot;
 
+// Notified about writes that land in a watched page (e.g. one holding predecoded code).
+class MemoryWatcher {
+public:
+    virtual void memoryWritten(uint16_t addr) = 0;
+    // The Memory is being destroyed or took another watcher, so it must not be touched again
+    virtual void memoryDetached() = 0;
+protected:
+    ~MemoryWatcher() = default;
+};
+
+// A device occupying one or more pages of the address space (see Memory::mapDevice).
+class MemoryHandler {
+public:
+    virtual uint8_t read(uint16_t addr) = 0;
+    virtual void write(uint16_t addr, uint8_t value) = 0;
+protected:
+    ~MemoryHandler() = default;
+};
+
+// 64 KB as 256 pages of 256 bytes behind a page table. A page points either at
+// host memory, which reads and writes index directly, or is null and belongs to
+// a device handler. Copying a Memory forks it: both copies share every page
+// read-only and a page is only duplicated by the first write to it, so a fork
+// costs the pages it dirties. Pinned memories keep their pages in storage owned
+// by the caller and copy instead of sharing.
 class Memory {
 private:
     using Byte = unsigned char;
     using Word = unsigned short;
 
     static constexpr uint32_t MAXMEM = 65536;
+    static constexpr uint32_t PAGES = 256;
+    static constexpr uint32_t PAGE_SIZE = 256;
+
+    //Page flags, any of them sends a write down the slow path
+    static constexpr Byte SHARED = 0x01;        //Another Memory still reads this page
+    static constexpr Byte WATCHED = 0x02;
+    static constexpr Byte TRACKED = 0x04;       //Clean since the baseline snapshot, next write dirties it
+    static constexpr Byte DEVICE = 0x08;        //Handled by handlers[page], pages[page] is null
+
+    Byte* pages[PAGES]{};
+    mutable Byte pageFlags[PAGES]{};            //Forking marks the source shared as well
+    std::shared_ptr<Byte[]> frames[PAGES];      //Keep shared pages alive, empty when pinned
+    Byte* storage = nullptr;                    //Caller's 64 KB when pinned
+    bool pinned = false;
+    MemoryWatcher* watcher = nullptr;
+    MemoryHandler* handlers[PAGES]{};
+    uint32_t devices = 0;                       //Pages mapped to a handler
+    uint32_t layoutVersion = 0;                 //Bumped whenever a device is mapped or unmapped
+
+    uint64_t dirtyPages[PAGES / 64]{};          //Written since the baseline snapshot
+    uint64_t baseline = 0;                      //Id of that snapshot, 0 when nothing is tracked
+
+    [[nodiscard]] Byte* ram(const Byte page) const { return pinned ? storage + page * PAGE_SIZE : frames[page].get(); }
+    void remap(const Byte page) { pages[page] = handlers[page] ? nullptr : ram(page); }
+    void map(const std::shared_ptr<Byte[]> &block);
+    void unshare(Byte page);
+    void markDirty(Byte page);
+    void touch(Byte page);
+    void writeSlow(Word addr, Byte value);
+    void pageReplaced(Byte page);               //Tells the watcher every byte of a watched page changed
+    [[nodiscard]] Byte readDevice(Word addr) const;
+
+    //Used by Snapshot
+    friend class Snapshot;
+    void track(uint64_t snapshot);
+    [[nodiscard]] std::shared_ptr<Byte[]> sharePage(Byte page) const;
+    void replacePage(Byte page, const std::shared_ptr<Byte[]> &frame);
 
 public:
-    Byte Data[MAXMEM]{};
+    Memory();
+    explicit Memory(Byte* storage);             //Pinned onto 64 KB owned by the caller
+    Memory(const Memory &other);                //Copy-on-write fork, without the watcher
+    Memory &operator=(const Memory &other);     //Same, keeps this watcher and reports its watched pages rewritten
+    ~Memory();                                  //Detaches the watcher
+
     void clear();
+    void share() const;                         //Marks every page shared up front, see Farm
     Byte operator[](Word byte) const;
-    Byte &operator[](Word byte);
+    Byte &operator[](Word byte);                //RAM under any device, unshared, the watcher is not notified
+    void mapShared(Word addr, const std::shared_ptr<Byte[]> &bytes, uint32_t length); //e.g. an mmapped ROM
+    Byte readByte(const Word addr) const {
+        if (const Byte* page = pages[addr >> 8]) [[likely]] {
+            return page[addr & 0xFF];
+        }
+        return readDevice(addr);
+    }
     Byte readByte(const Word &addr, int &cycles) const;
-    void writeByte(const Word &addr, Byte value);
-    Memory();
+    void writeByte(const Word &addr, const Byte value) {
+        if (pageFlags[addr >> 8]) [[unlikely]] {
+            writeSlow(addr, value);
+            return;
+        }
+        pages[addr >> 8][addr & 0xFF] = value;
+    }
+
+    // Pages first to first + count - 1 go to handler, nullptr gives them back
+    // to the RAM underneath. Forks share the handler objects.
+    void mapDevice(Byte first, uint32_t count, MemoryHandler* handler);
+    [[nodiscard]] bool hasDevices() const { return devices != 0; }
+    [[nodiscard]] uint32_t layout() const { return layoutVersion; }
+    [[nodiscard]] Byte* const* pageTable() const { return pages; } //Null entries are devices
+
+    // A watcher that gets replaced by another one is told it was detached
+    void attachWatcher(MemoryWatcher* memoryWatcher);
+    void watchPage(Byte page, bool watched);
 };
 
 #endif //MEMORY_H
@@ -0,0 +1,88 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Pacer.h"
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include "CPU.h"
+
+Pacer::Pacer(Cpu &cpu, Memory &memory, const Config &config)
+    : cpu(cpu), memory(memory), config(config) {
+    rebase();
+}
+
+void Pacer::rebase() {
+    epoch = Clock::now();
+    epochCycles = cycles;
+}
+
+void Pacer::setTurbo(const double multiplier) {
+    config.turbo = multiplier;
+    rebase();
+}
+
+void Pacer::setUnthrottled(const bool unthrottled) {
+    config.unthrottled = unthrottled;
+    rebase();
+}
+
+// Sleeping overshoots by up to the host's timer slack, so the last stretch
+// before the deadline is spun instead
+void Pacer::waitUntil(const Clock::time_point deadline) const {
+    const Clock::time_point wake = deadline - config.spin;
+    if (Clock::now() < wake) {
+        std::this_thread::sleep_until(wake);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void Pacer::run(const uint64_t count) {
+    const Clock::time_point start = Clock::now();
+    rebase(); //Time between two run() calls is not owed to the guest
+
+    uint64_t left = count;
+    while (left > 0) {
+        const auto slice = static_cast<uint64_t>(rate() * std::chrono::duration<double>(config.slice).count());
+        const uint64_t budget = std::min<uint64_t>({left, config.unthrottled ? left : std::max<uint64_t>(slice, 1), INT_MAX});
+        const uint64_t before = cpu.stats().cycles;
+        cpu.execute(static_cast<int>(budget), memory);
+        const uint64_t ran = std::max<uint64_t>(cpu.stats().cycles - before, 1);
+        cycles += ran;
+        left -= std::min(ran, left);
+        if (cpu.hasHalted()) {
+            break; //HLT ran, the next execute() would carry on past it
+        }
+        if (config.unthrottled) {
+            continue;
+        }
+
+        const Clock::time_point due = epoch + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(cycles - epochCycles) / rate()));
+        if (Clock::now() < due) {
+            waitUntil(due);
+        }
+        const Clock::duration late = Clock::now() - due;
+        drift = std::chrono::duration<double>(late).count();
+        maxJitter = std::max(maxJitter, drift);
+        if (late > config.maxLag) {
+            resyncs++; //The host cannot keep up, start a fresh schedule instead of racing to catch up
+            rebase();
+        }
+    }
+    busy += Clock::now() - start;
+}
+
+Pacer::Report Pacer::report() const {
+    Report report;
+    report.cycles = cycles;
+    report.seconds = std::chrono::duration<double>(busy).count();
+    report.achievedHz = report.seconds > 0 ? static_cast<double>(cycles) / report.seconds : 0;
+    report.driftSeconds = drift;
+    report.maxJitterSeconds = maxJitter;
+    report.resyncs = resyncs;
+    return report;
+}
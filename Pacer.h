@@ -0,0 +1,66 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <chrono>
+#include <cstdint>
+class Cpu;
+class Memory;
+
+// Runs a Cpu at a real clock rate instead of as fast as the host allows. Work
+// is done in short slices; after each one the pacer sleeps until shortly
+// before the slice is due and spins the rest, which keeps jitter well below
+// the scheduler's sleep granularity while an idle guest costs little host CPU.
+class Pacer {
+public:
+    struct Config {
+        double clockHz = 1'000'000;          //Emulated clock, e.g. 1.79e6 for NTSC machines
+        double turbo = 1.0;                  //Multiplier on clockHz
+        bool unthrottled = false;            //No pacing at all, still reports the achieved rate
+        std::chrono::microseconds slice{2000};
+        std::chrono::microseconds spin{100}; //Tail of every wait that is spun instead of slept
+        std::chrono::milliseconds maxLag{100}; //Further behind than this the pacer stops catching up
+    };
+
+    struct Report {
+        uint64_t cycles = 0;
+        double seconds = 0;                  //Wall time spent in run()
+        double achievedHz = 0;
+        double driftSeconds = 0;             //Wall clock minus emulated time, positive when behind
+        double maxJitterSeconds = 0;         //Worst lateness of a slice deadline
+        uint64_t resyncs = 0;                //Times maxLag was exceeded and the schedule restarted
+    };
+
+    Pacer(Cpu &cpu, Memory &memory, const Config &config);
+
+    void run(uint64_t cycles);               //Blocks until cycles have run at the paced rate, or HLT
+    void setTurbo(double multiplier);
+    void setUnthrottled(bool unthrottled);
+
+    [[nodiscard]] const Config &configuration() const { return config; }
+    [[nodiscard]] Report report() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Cpu &cpu;
+    Memory &memory;
+    Config config;
+
+    Clock::time_point epoch;                 //Wall time emulated cycle epochCycles was due
+    uint64_t epochCycles = 0;
+    uint64_t cycles = 0;                     //Run so far, over every run() call
+    Clock::duration busy{};
+    double drift = 0;
+    double maxJitter = 0;
+    uint64_t resyncs = 0;
+
+    [[nodiscard]] double rate() const { return config.clockHz * config.turbo; }
+    void rebase();
+    void waitUntil(Clock::time_point deadline) const;
+};
+
+#endif //PACER_H
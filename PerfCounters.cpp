@@ -0,0 +1,168 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include "CPU.h"
+#include "Emulator.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::Reading &PerfCounters::Reading::operator+=(const Reading &other) {
+    for (size_t event = 0; event < EVENTS; event++) {
+        host[event] += other.host[event];
+        valid[event] = valid[event] || other.valid[event];
+    }
+    instructions += other.instructions;
+    cycles += other.cycles;
+    seconds += other.seconds;
+    return *this;
+}
+
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+#ifdef __linux__
+    std::string missing;
+    for (size_t event = 0; event < EVENTS; event++) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (event) {
+            case HOST_CYCLES:
+                attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case HOST_INSTRUCTIONS:
+                attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case BRANCH_MISSES:
+                attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            default:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                              PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+                break;
+        }
+        fds[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)); //This thread, any CPU
+        if (fds[event] < 0) {
+            missing += std::string(missing.empty() ? "" : ", ") + name(static_cast<Event>(event)) + " (" + std::strerror(errno) + ")";
+        }
+    }
+    if (!missing.empty()) {
+        Emulator::log(0, Emulator::WARNING, "Host counters unavailable: ", missing);
+    }
+#else
+    Emulator::log(0, Emulator::WARNING, "Host counters need Linux perf events, only wall time is measured");
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    return std::any_of(fds.begin(), fds.end(), [](const int fd) { return fd >= 0; });
+}
+
+const char *PerfCounters::name(const Event event) {
+    switch (event) {
+        case HOST_CYCLES: return "cycles";
+        case HOST_INSTRUCTIONS: return "instructions";
+        case BRANCH_MISSES: return "branch-misses";
+        default: return "L1-dcache-load-misses";
+    }
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void PerfCounters::stop(Reading &reading) {
+#ifdef __linux__
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t event = 0; event < EVENTS; event++) {
+        uint64_t values[3]; //Count, time enabled, time running
+        if (fds[event] < 0 || read(fds[event], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+            continue;
+        }
+        reading.host[event] = values[2] < values[1]
+                                  ? static_cast<uint64_t>(static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]))
+                                  : values[0];
+        reading.valid[event] = true;
+    }
+#endif
+}
+
+PerfCounters::Reading PerfCounters::execute(Cpu &cpu, Memory &memory, const int cycles) {
+    Reading reading;
+    const Cpu::Stats before = cpu.stats();
+    const auto begin = std::chrono::steady_clock::now();
+    start();
+    cpu.execute(cycles, memory);
+    stop(reading);
+    reading.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const Cpu::Stats after = cpu.stats();
+    reading.instructions = after.instructions - before.instructions;
+    reading.cycles = after.cycles - before.cycles;
+    return reading;
+}
+
+std::vector<PerfCounters::Reading> PerfCounters::execute(Cpu &cpu, Memory &memory, int cycles, const int window) {
+    std::vector<Reading> readings;
+    while (cycles > 0) {
+        const int slice = std::min(cycles, std::max(1, window));
+        const Reading reading = execute(cpu, memory, slice);
+        readings.push_back(reading);
+        cycles -= static_cast<int>(reading.cycles);
+        if (reading.cycles < static_cast<uint64_t>(slice)) {
+            break; //HLT ended the window early
+        }
+    }
+    return readings;
+}
+
+void PerfCounters::report(std::ostream &out, const Reading &reading) {
+    out << reading.instructions << " guest instructions, " << reading.cycles << " guest cycles in "
+        << std::fixed << std::setprecision(6) << reading.seconds << " s\n";
+    for (size_t event = 0; event < EVENTS; event++) {
+        out << std::setw(24) << name(static_cast<Event>(event)) << "  ";
+        if (reading.valid[event]) {
+            out << std::setw(14) << reading.host[event] << std::setprecision(3) << std::setw(10)
+                << reading.perInstruction(static_cast<Event>(event)) << " per guest instruction\n";
+        } else {
+            out << std::setw(14) << "n/a" << "\n";
+        }
+    }
+    if (reading.hostIPC() > 0) {
+        out << std::setw(24) << "host IPC" << "  " << std::setw(14) << std::setprecision(3) << reading.hostIPC() << "\n";
+    }
+}
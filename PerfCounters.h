@@ -0,0 +1,64 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+class Cpu;
+class Memory;
+
+// Host hardware counters (Linux perf_event_open) around Cpu::execute, set
+// against the guest instructions and cycles run in the same span. Counters
+// the kernel, the CPU or the container refuse are left out one by one; with
+// none at all (or off Linux) measuring still runs the CPU and reports wall time.
+// Only user space is counted, which most perf_event_paranoid settings allow.
+class PerfCounters {
+public:
+    enum Event {HOST_CYCLES, HOST_INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, EVENTS};
+
+    struct Reading {
+        std::array<uint64_t, EVENTS> host{};  //Scaled when the kernel had to multiplex
+        std::array<bool, EVENTS> valid{};
+        uint64_t instructions = 0;           //Guest instructions retired
+        uint64_t cycles = 0;                 //Guest cycles
+        double seconds = 0;
+
+        [[nodiscard]] double perInstruction(const Event event) const {
+            return valid[event] && instructions ? static_cast<double>(host[event]) / static_cast<double>(instructions) : 0;
+        }
+        [[nodiscard]] double hostIPC() const {
+            return valid[HOST_CYCLES] && valid[HOST_INSTRUCTIONS] && host[HOST_CYCLES]
+                       ? static_cast<double>(host[HOST_INSTRUCTIONS]) / static_cast<double>(host[HOST_CYCLES]) : 0;
+        }
+        Reading &operator+=(const Reading &other);
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters &operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool available() const;     //At least one counter opened
+    [[nodiscard]] bool available(Event event) const { return fds[event] >= 0; }
+
+    Reading execute(Cpu &cpu, Memory &memory, int cycles);    //One execute() call
+    // The same budget in windows of window cycles, one reading each
+    std::vector<Reading> execute(Cpu &cpu, Memory &memory, int cycles, int window);
+
+    static const char *name(Event event);
+    static void report(std::ostream &out, const Reading &reading);
+
+private:
+    std::array<int, EVENTS> fds{};
+
+    void start();
+    void stop(Reading &reading);
+};
+
+#endif //PERFCOUNTERS_H
@@ -0,0 +1,161 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include "Emulator.h"
+
+Profiler::Profiler() : counts(std::make_unique<uint64_t[]>(0x10000)), cyclesAt(std::make_unique<uint64_t[]>(0x10000)) {
+    clear();
+}
+
+void Profiler::clear() {
+    std::fill_n(counts.get(), 0x10000, 0);
+    std::fill_n(cyclesAt.get(), 0x10000, 0);
+    nodes.assign(1, Node{0, 0});
+    frames.clear();
+    current = 0;
+}
+
+void Profiler::call(const Word routine, const Byte callerSP) {
+    if (frames.size() >= MAX_DEPTH) {
+        return;
+    }
+    uint32_t child = nodes[current].firstChild;
+    while (child && nodes[child].routine != routine) {
+        child = nodes[child].nextSibling;
+    }
+    if (!child) {
+        child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{routine, current, 0, nodes[current].firstChild});
+        nodes[current].firstChild = child;
+    }
+    frames.push_back({current, callerSP});
+    current = child;
+}
+
+void Profiler::unwind(const Byte sp) {
+    while (!frames.empty() && frames.back().callerSP <= sp) {
+        current = frames.back().node;
+        frames.pop_back();
+    }
+}
+
+namespace {
+    bool parseHex(const std::string &text, unsigned &value) {
+        if (text.empty() || text.size() > 4 || !std::all_of(text.begin(), text.end(), ::isxdigit)) {
+            return false;
+        }
+        value = std::stoul(text, nullptr, 16);
+        return true;
+    }
+
+    // $C000, 0xC000 and C:C000 are addresses for sure, a bare C000 only when nothing else is
+    bool parseAddress(const std::string &token, unsigned &value, const bool bare) {
+        if (token.size() > 1 && token[0] == '$') {
+            return parseHex(token.substr(1), value);
+        }
+        if (token.size() > 2 && (token.compare(0, 2, "0x") == 0 || token.compare(0, 2, "C:") == 0)) {
+            return parseHex(token.substr(2), value);
+        }
+        return bare && token.size() == 4 && parseHex(token, value);
+    }
+}
+
+bool Profiler::loadSymbols(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        Emulator::log(0, Emulator::ERROR, "Could not open symbol file: ", path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find_first_of(";#"));
+        std::replace(line.begin(), line.end(), '=', ' ');
+        std::vector<std::string> tokens;
+        std::istringstream words(line);
+        for (std::string word; words >> word;) {
+            tokens.push_back(word);
+        }
+
+        for (const bool bare : {false, true}) {
+            unsigned address = 0;
+            const auto at = std::find_if(tokens.begin(), tokens.end(), [&](const std::string &token) {
+                return parseAddress(token, address, bare);
+            });
+            if (at == tokens.end()) {
+                continue;
+            }
+            tokens.erase(at);
+            auto label = std::find_if(tokens.begin(), tokens.end(), [](const std::string &token) { return token[0] == '.'; });
+            if (label == tokens.end()) {
+                label = tokens.begin();
+            }
+            if (label != tokens.end()) {
+                symbols[static_cast<Word>(address)] = label->front() == '.' ? label->substr(1) : *label;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+std::string Profiler::name(const Word address) const {
+    std::stringstream text;
+    auto symbol = symbols.upper_bound(address);
+    if (symbol != symbols.begin()) {
+        --symbol;
+        text << symbol->second;
+        if (symbol->first != address) {
+            text << "+$" << std::hex << std::uppercase << address - symbol->first;
+        }
+    } else {
+        text << "$" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << address;
+    }
+    return text.str();
+}
+
+std::string Profiler::path(const uint32_t node) const {
+    if (node == 0) {
+        return "6502";
+    }
+    return path(nodes[node].parent) + ";" + name(nodes[node].routine);
+}
+
+void Profiler::hotSpots(std::ostream &out, const size_t top) const {
+    std::vector<Word> hot;
+    uint64_t total = 0;
+    for (uint32_t pc = 0; pc < 0x10000; pc++) {
+        if (counts[pc]) {
+            hot.push_back(static_cast<Word>(pc));
+            total += cyclesAt[pc];
+        }
+    }
+    const size_t shown = std::min(top, hot.size());
+    std::partial_sort(hot.begin(), hot.begin() + static_cast<std::ptrdiff_t>(shown), hot.end(),
+                      [this](const Word a, const Word b) { return cyclesAt[a] > cyclesAt[b]; });
+
+    out << "   PC        cycles      %       count  routine\n";
+    for (size_t i = 0; i < shown; i++) {
+        const Word pc = hot[i];
+        out << "$" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << pc << std::dec << std::setfill(' ')
+            << std::setw(14) << cyclesAt[pc]
+            << std::fixed << std::setprecision(2) << std::setw(7) << 100.0 * static_cast<double>(cyclesAt[pc]) / static_cast<double>(total)
+            << std::setw(12) << counts[pc] << "  " << name(pc) << "\n";
+    }
+}
+
+void Profiler::collapsedStacks(std::ostream &out) const {
+    for (uint32_t node = 0; node < nodes.size(); node++) {
+        if (nodes[node].cycles) {
+            out << path(node) << " " << nodes[node].cycles << "\n";
+        }
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Per-instruction profiling of the CPU run loop, enabled at build time with the
+// EMU_PROFILE CMake option. Without it every profiling statement compiles out.
+#ifdef EMU_PROFILE
+constexpr bool profilingEnabled = true;
+#else
+constexpr bool profilingEnabled = false;
+#endif
+
+// Counts executions and cycles per PC in flat 64K arrays, and follows JSR/RTS
+// (and BRK, interrupts and RTI) as a call tree so cycles can be charged to the
+// 6502 routine they were spent in. A frame is left once the stack pointer has
+// risen back above where it was called from, so code that drops return
+// addresses or returns with RTI still unwinds correctly.
+class Profiler {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    Profiler();
+
+    // After every instruction: opcode at pc took cycles, the CPU is now at next with stack pointer sp
+    void record(const Word pc, const Byte opcode, const uint32_t cycles, const Word next, const Byte sp) {
+        counts[pc]++;
+        cyclesAt[pc] += cycles;
+        nodes[current].cycles += cycles;
+        switch (opcode) {
+            case 0x20: call(next, static_cast<Byte>(sp + 2)); break; //JSR
+            case 0x00: call(next, static_cast<Byte>(sp + 3)); break; //BRK
+            case 0x40: case 0x60: unwind(sp); break;                 //RTI RTS
+            default: break;
+        }
+    }
+    void call(Word routine, Byte callerSP);   //Enters routine; callerSP is the stack pointer before the return address went on
+    void clear();
+
+    // Lines of "address name" in either order. Addresses as $C000, 0xC000, C000
+    // or VICE style C:C000, names may start with a dot ("al C:C000 .reset").
+    bool loadSymbols(const std::string &path);
+
+    void hotSpots(std::ostream &out, size_t top = 20) const; //Addresses by cycles spent, with execution counts
+    void collapsedStacks(std::ostream &out) const;           //"outer;inner cycles" per call path, for flamegraph.pl
+
+    [[nodiscard]] uint64_t count(const Word pc) const { return counts[pc]; }
+    [[nodiscard]] uint64_t cycles(const Word pc) const { return cyclesAt[pc]; }
+
+private:
+    static constexpr size_t MAX_DEPTH = 256;  //Deeper calls are charged to the deepest frame
+
+    struct Node {
+        Word routine;
+        uint32_t parent;
+        uint32_t firstChild = 0, nextSibling = 0; //0: none, the root is never anyone's child
+        uint64_t cycles = 0;                    //Spent in this routine itself on this path
+    };
+    struct Frame {
+        uint32_t node;
+        Byte callerSP;
+    };
+
+    std::unique_ptr<uint64_t[]> counts;
+    std::unique_ptr<uint64_t[]> cyclesAt;
+    std::vector<Node> nodes;                  //Call tree, nodes[0] is the root
+    std::vector<Frame> frames;                //Active calls, innermost last
+    uint32_t current = 0;
+    std::map<Word, std::string> symbols;
+
+    void unwind(Byte sp);
+    [[nodiscard]] std::string name(Word address) const; //Nearest symbol at or below, with an offset
+    [[nodiscard]] std::string path(uint32_t node) const;
+};
+
+#endif //PROFILER_H
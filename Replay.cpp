@@ -0,0 +1,217 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Replay.h"
+#include <algorithm>
+#include <climits>
+#include <string>
+#include "Emulator.h"
+
+// Stands in for a device in the page table and sends both directions through
+// the recorder
+class Replay::Device final : public MemoryHandler {
+public:
+    Device(Replay &owner, MemoryHandler &handler, const Byte first, const uint32_t count)
+        : owner(owner), handler(handler), first(first), count(count) {}
+
+    uint8_t read(const uint16_t addr) override { return owner.deviceRead(handler, addr); }
+    void write(const uint16_t addr, const uint8_t value) override { owner.deviceWrite(handler, addr, value); }
+
+    Replay &owner;
+    MemoryHandler &handler;
+    const Byte first;
+    const uint32_t count;
+};
+
+Replay::Replay(Cpu &cpu, Memory &memory, const Config &config)
+    : cpu(cpu), memory(memory), config(config), origin(cpu.retired) {
+    this->config.checkpointCycles = std::max(1, config.checkpointCycles);
+    this->config.maxCheckpoints = std::max<size_t>(2, config.maxCheckpoints);
+    cpu.attachInterruptListener(this);
+    checkpoint();
+}
+
+Replay::~Replay() {
+    cpu.attachInterruptListener(nullptr);
+    for (const auto &device : devices) {
+        memory.mapDevice(device->first, device->count, &device->handler); //Hand the pages back
+    }
+}
+
+void Replay::mapDevice(const Byte first, const uint32_t count, MemoryHandler *handler) {
+    if (!handler) {
+        memory.mapDevice(first, count, nullptr);
+        return;
+    }
+    devices.push_back(std::make_unique<Device>(*this, *handler, first, count));
+    memory.mapDevice(first, count, devices.back().get());
+}
+
+void Replay::interruptTaken(const bool nmi) {
+    if (!replaying) {
+        taken.push_back({position(), nmi});
+        nextInterrupt = taken.size();
+    }
+}
+
+Replay::Byte Replay::deviceRead(MemoryHandler &handler, const Word addr) {
+    if (!replaying) {
+        const Byte value = handler.read(addr);
+        reads.push_back(value);
+        nextRead = reads.size();
+        return value;
+    }
+    if (nextRead < reads.size()) [[likely]] {
+        return reads[nextRead++];
+    }
+    Emulator::log(cpu.totalCycles, Emulator::ERROR, "Replay read past the recorded inputs at: ", addr);
+    return 0;
+}
+
+void Replay::deviceWrite(MemoryHandler &handler, const Word addr, const Byte value) const {
+    if (!replaying) {
+        handler.write(addr, value); //The device already saw the replayed writes
+    }
+}
+
+void Replay::checkpoint() {
+    saved.push_back({position(), Snapshot::capture(cpu, memory), nextRead, nextInterrupt});
+    sinceCheckpoint = 0;
+    if (saved.size() > config.maxCheckpoints) {
+        //Keep the first and every second one after it
+        size_t kept = 1;
+        for (size_t i = 2; i < saved.size(); i += 2) {
+            saved[kept++] = std::move(saved[i]);
+        }
+        if (saved.size() % 2 == 0) {
+            saved[kept++] = std::move(saved.back()); //Never lose the newest
+        }
+        saved.resize(kept);
+    }
+}
+
+void Replay::truncate() {
+    const uint64_t now = position();
+    Emulator::log(cpu.totalCycles, Emulator::INFO, "Recording again from instruction: ", std::to_string(now));
+    reads.resize(nextRead);
+    taken.resize(nextInterrupt);
+    saved.resize(checkpointBefore(now) + 1);
+    sinceCheckpoint = 0; //Counts from here, close enough for spacing
+    recorded = now;
+}
+
+void Replay::record(const int cycles) {
+    if (position() < recorded) {
+        truncate();
+    }
+    int left = cycles;
+    while (left > 0) {
+        const uint64_t start = cpu.totalCycles;
+        const int slice = std::min(left, config.checkpointCycles - sinceCheckpoint);
+        cpu.execute(slice, memory);
+        const auto ran = static_cast<int>(cpu.totalCycles - start);
+        left -= ran;
+        sinceCheckpoint += ran;
+        recorded = position();
+        pendingAtEnd = cpu.pendingInterrupts;
+        if (sinceCheckpoint >= config.checkpointCycles) {
+            checkpoint();
+        }
+        if (ran < slice) {
+            break; //HLT
+        }
+    }
+}
+
+size_t Replay::checkpointBefore(const uint64_t target) const {
+    const auto after = std::upper_bound(saved.begin(), saved.end(), target,
+                                        [](const uint64_t value, const Checkpoint &checkpoint) {
+                                            return value < checkpoint.position;
+                                        });
+    return static_cast<size_t>(after - saved.begin()) - 1; //The first one is at 0
+}
+
+void Replay::restore(const Checkpoint &from) {
+    from.snapshot.restore(cpu, memory);
+    cpu.retired = origin + from.position;
+    cpu.pendingInterrupts = 0; //Interrupts come from the log from here on
+    nextRead = from.reads;
+    nextInterrupt = from.interrupts;
+}
+
+// Runs the engine in budgets of as many cycles as there are instructions left
+// before the target or the next logged interrupt. Every instruction costs at
+// least a cycle, so no budget overshoots, and each one covers a good part of
+// what is left. Interrupts logged at a position are entered as soon as it is
+// reached, so PC is always the next instruction to run, handlers included.
+void Replay::runTo(const uint64_t target) {
+    replaying = true;
+    while (true) {
+        while (nextInterrupt < taken.size() && taken[nextInterrupt].position == position()) {
+            taken[nextInterrupt++].nmi ? cpu.assertNMI() : cpu.assertIRQ();
+            int cycles = 0;
+            cpu.interrupt(cycles, memory);
+        }
+        if (position() >= target) {
+            break;
+        }
+        uint64_t stop = target;
+        if (nextInterrupt < taken.size()) {
+            stop = std::min(stop, taken[nextInterrupt].position);
+        }
+        cpu.runEngine(static_cast<int>(std::min<uint64_t>(stop - position(), INT_MAX / 2)), memory);
+    }
+    if (target == recorded) {
+        cpu.pendingInterrupts = pendingAtEnd; //Back where the live devices left off
+    }
+    cpu.published.store(Cpu::IDLE_SAMPLE, std::memory_order_relaxed);
+    replaying = false;
+}
+
+bool Replay::seek(const uint64_t target) {
+    if (target > recorded) {
+        Emulator::log(cpu.totalCycles, Emulator::WARNING, "Seek past the end of the recording: ", std::to_string(target));
+        return false;
+    }
+    const Checkpoint &nearest = saved[checkpointBefore(target)];
+    if (target < position() || position() < nearest.position) {
+        restore(nearest);
+    }
+    runTo(target);
+    return true;
+}
+
+bool Replay::reverseStep() {
+    return position() > 0 && seek(position() - 1);
+}
+
+// Replays the segments between checkpoints newest first, one instruction at a
+// time, and stops at the first segment with a hit
+bool Replay::reverseContinue(const Word breakpoint) {
+    const uint64_t from = position();
+    if (from == 0) {
+        return false;
+    }
+    for (size_t segment = checkpointBefore(from - 1);; segment--) {
+        const uint64_t segmentEnd = segment + 1 < saved.size() ? std::min(from, saved[segment + 1].position) : from;
+        restore(saved[segment]);
+        uint64_t hit = UINT64_MAX;
+        while (position() < segmentEnd) {
+            if (cpu.PC == breakpoint) {
+                hit = position();
+            }
+            runTo(position() + 1);
+        }
+        if (hit != UINT64_MAX) {
+            restore(saved[segment]);
+            runTo(hit);
+            return true;
+        }
+        if (segment == 0) {
+            break;
+        }
+    }
+    seek(from);
+    return false;
+}
@@ -0,0 +1,105 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CPU.h"
+#include "Memory.h"
+#include "Snapshot.h"
+
+// Deterministic record and replay of a run. Given the same starting state the
+// CPU only diverges through what comes from outside, so that is all that is
+// logged: every byte read from a device mapped through the recorder and the
+// instruction count at which each hardware interrupt was taken. A checkpoint
+// (a copy-on-write Snapshot) is taken every checkpointCycles while recording.
+// Seeking restores the nearest checkpoint at or before the target, then runs
+// forward feeding the logged reads back and raising the logged interrupts at
+// the same instruction boundaries, which reproduces registers and memory bit
+// for bit. Reverse step and reverse continue are seeks to an earlier position.
+//
+// Positions count retired instructions since the recorder was created. While
+// replaying, device writes are dropped and the CPU's scheduler does not run;
+// inputs that reach memory any other way (e.g. a scheduler callback writing
+// RAM directly) are not recorded. Devices must only be read by the CPU.
+class Replay : private InterruptListener {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    struct Config {
+        int checkpointCycles = 1'000'000;
+        size_t maxCheckpoints = 1024;       //Beyond that every other one is dropped, doubling the spacing
+    };
+
+    Replay(Cpu &cpu, Memory &memory, const Config &config);
+    ~Replay();
+
+    Replay(const Replay&) = delete;
+    Replay &operator=(const Replay&) = delete;
+
+    // Maps handler like Memory::mapDevice, behind a proxy that logs its reads
+    void mapDevice(Byte first, uint32_t count, MemoryHandler* handler);
+
+    // Runs the CPU live and appends to the recording. From an earlier position
+    // the recording after it is dropped first and history is rewritten.
+    void record(int cycles);
+
+    bool seek(uint64_t target);             //False past the end of the recording
+    bool reverseStep();                     //Back to the previous instruction boundary
+    bool reverseContinue(Word breakpoint);  //Back to the last earlier position with PC == breakpoint
+
+    [[nodiscard]] uint64_t position() const { return cpu.retired - origin; }
+    [[nodiscard]] uint64_t end() const { return recorded; }
+    [[nodiscard]] size_t checkpoints() const { return saved.size(); }
+    [[nodiscard]] size_t inputs() const { return reads.size(); }
+    [[nodiscard]] size_t interrupts() const { return taken.size(); }
+
+private:
+    class Device;
+
+    struct Checkpoint {
+        uint64_t position;
+        Snapshot snapshot;
+        size_t reads;                       //Log cursors at that point
+        size_t interrupts;
+    };
+    struct Interrupt {
+        uint64_t position;
+        bool nmi;
+    };
+
+    Cpu &cpu;
+    Memory &memory;
+    Config config;
+    uint64_t origin;                        //cpu.retired at position 0
+    uint64_t recorded = 0;                  //End of the recording
+    int sinceCheckpoint = 0;                //Cycles recorded since the last checkpoint
+    uint32_t pendingAtEnd = 0;              //Requests still waiting when recording stopped, e.g. a masked IRQ
+    bool replaying = false;
+
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<Byte> reads;
+    size_t nextRead = 0;
+    std::vector<Interrupt> taken;
+    size_t nextInterrupt = 0;
+    std::vector<Checkpoint> saved;
+
+    void interruptTaken(bool nmi) override;
+    Byte deviceRead(MemoryHandler &handler, Word addr);
+    void deviceWrite(MemoryHandler &handler, Word addr, Byte value) const;
+
+    void checkpoint();
+    void truncate();
+    void restore(const Checkpoint &from);
+    [[nodiscard]] size_t checkpointBefore(uint64_t target) const; //Last one at or before target
+    void runTo(uint64_t target);
+};
+
+#endif //REPLAY_H
@@ -0,0 +1,85 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Sampler.h"
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+#include "CPU.h"
+
+Sampler::Sampler(Cpu &cpu, const Config &config)
+    : cpu(cpu), config(config),
+      pcs(std::make_unique<uint64_t[]>(0x10000)), sites(std::make_unique<uint64_t[]>(0x10000)) {
+}
+
+Sampler::~Sampler() {
+    stop();
+}
+
+void Sampler::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    cpu.publishStack(config.stack);
+    thread = std::thread(&Sampler::sample, this);
+}
+
+void Sampler::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    thread.join();
+    cpu.publishStack(false);
+}
+
+void Sampler::sample() {
+    auto next = std::chrono::steady_clock::now();
+    while (running.load(std::memory_order_relaxed)) {
+        next += config.interval;
+        std::this_thread::sleep_until(next);
+
+        const uint64_t position = cpu.sample();
+        taken++;
+        if (position & Cpu::IDLE_SAMPLE) {
+            idleSamples++;
+            continue;
+        }
+        pcs[position & 0xFFFF]++;
+        if (config.stack) {
+            sites[static_cast<Word>((position >> 32) - 2)]++; //JSR pushes the address of its last byte
+        }
+    }
+}
+
+void Sampler::report(std::ostream &out, const size_t top) const {
+    const uint64_t busy = taken - idleSamples;
+    out << taken << " samples, " << idleSamples << " idle\n";
+    if (busy == 0) {
+        return;
+    }
+
+    const auto table = [&](const char *title, const uint64_t *counts) {
+        std::vector<Word> hot;
+        for (uint32_t addr = 0; addr < 0x10000; addr++) {
+            if (counts[addr]) {
+                hot.push_back(static_cast<Word>(addr));
+            }
+        }
+        const size_t shown = std::min(top, hot.size());
+        std::partial_sort(hot.begin(), hot.begin() + static_cast<std::ptrdiff_t>(shown), hot.end(),
+                          [&](const Word a, const Word b) { return counts[a] > counts[b]; });
+        out << title << "\n";
+        for (size_t i = 0; i < shown; i++) {
+            out << "$" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << hot[i]
+                << std::dec << std::setfill(' ') << std::setw(12) << counts[hot[i]]
+                << std::fixed << std::setprecision(2) << std::setw(8)
+                << 100.0 * static_cast<double>(counts[hot[i]]) / static_cast<double>(busy) << "%\n";
+        }
+    };
+    table("   PC     samples", pcs.get());
+    if (config.stack) {
+        table(" JSR     samples", sites.get());
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <thread>
+class Cpu;
+
+// Statistical profiler for long or production runs. A host thread reads the
+// position the CPU publishes before every instruction at a fixed interval and
+// counts it per address, so the emulation thread pays one relaxed store per
+// instruction and nothing else. With stack sampling the word above SP is
+// counted as well; after a JSR that is the return address, which tells which
+// call site the time was spent under.
+class Sampler {
+private:
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+public:
+    struct Config {
+        std::chrono::microseconds interval{100};
+        bool stack = false;                  //Also histogram call sites from the top of the 6502 stack
+    };
+
+    Sampler(Cpu &cpu, const Config &config);
+    ~Sampler();                              //Stops sampling
+
+    Sampler(const Sampler&) = delete;
+    Sampler &operator=(const Sampler&) = delete;
+
+    void start();
+    void stop();
+
+    // Read these once stopped
+    [[nodiscard]] uint64_t samples() const { return taken; }
+    [[nodiscard]] uint64_t idle() const { return idleSamples; } //Taken while the CPU was outside execute()
+    [[nodiscard]] uint64_t at(const Word pc) const { return pcs[pc]; }
+    [[nodiscard]] uint64_t under(const Word site) const { return sites[site]; } //Samples below the JSR at site
+    void report(std::ostream &out, size_t top = 20) const;
+
+private:
+    Cpu &cpu;
+    Config config;
+    std::unique_ptr<uint64_t[]> pcs;
+    std::unique_ptr<uint64_t[]> sites;
+    uint64_t taken = 0;
+    uint64_t idleSamples = 0;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    void sample();
+};
+
+#endif //SAMPLER_H
@@ -0,0 +1,38 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Scheduler.h"
+#include <algorithm>
+
+Scheduler::Id Scheduler::schedule(const uint64_t deadline, Callback callback) {
+    heap.push_back({std::max(deadline, earliest), nextId, std::move(callback)});
+    std::push_heap(heap.begin(), heap.end(), later);
+    return nextId++;
+}
+
+bool Scheduler::cancel(const Id id) {
+    const auto event = std::find_if(heap.begin(), heap.end(), [id](const Event &e) { return e.id == id; });
+    if (event == heap.end()) {
+        return false;
+    }
+    *event = std::move(heap.back());
+    heap.pop_back();
+    std::make_heap(heap.begin(), heap.end(), later);
+    return true;
+}
+
+void Scheduler::clear() {
+    heap.clear();
+}
+
+void Scheduler::fire(const uint64_t now) {
+    earliest = now + 1; //Only events that were already due fire now
+    while (!heap.empty() && heap.front().deadline <= now) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const Callback callback = std::move(heap.back().callback);
+        heap.pop_back();
+        callback(now);
+    }
+    earliest = 0;
+}
@@ -0,0 +1,46 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Peripheral events keyed on the CPU cycle they are due at, kept in a min-heap.
+// Cpu::execute runs straight to the earliest deadline, fires everything that is
+// due and carries on, so devices are never polled between their events. A due
+// event fires after the instruction that reached its deadline. Callbacks that
+// schedule at or before the cycle they fired at get the next cycle instead, so
+// a zero period timer cannot stop the CPU.
+class Scheduler {
+public:
+    using Id = uint64_t;
+    using Callback = std::function<void(uint64_t now)>; //now: cycle it actually fired at
+
+    Id schedule(uint64_t deadline, Callback callback);  //Callbacks may schedule and cancel
+    bool cancel(Id id);
+    void clear();
+
+    [[nodiscard]] bool empty() const { return heap.empty(); }
+    [[nodiscard]] uint64_t nextDeadline() const { return heap.empty() ? UINT64_MAX : heap.front().deadline; }
+    void fire(uint64_t now);                            //Every event due by now, earliest first
+
+private:
+    struct Event {
+        uint64_t deadline;
+        Id id;                                          //Also keeps equal deadlines in schedule order
+        Callback callback;
+    };
+    static bool later(const Event &a, const Event &b) {
+        return a.deadline != b.deadline ? a.deadline > b.deadline : a.id > b.id;
+    }
+
+    std::vector<Event> heap;
+    Id nextId = 1;
+    uint64_t earliest = 0;                              //Deadline floor while fire() runs
+};
+
+#endif //SCHEDULER_H
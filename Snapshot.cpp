@@ -0,0 +1,83 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Snapshot.h"
+#include <atomic>
+#include <bit>
+#include "Emulator.h"
+
+namespace {
+    std::atomic<uint64_t> nextId{1};
+}
+
+Snapshot Snapshot::capture(const Cpu &cpu, Memory &memory) {
+    Snapshot snapshot;
+    snapshot.registers = cpu.saveState();
+    snapshot.base = std::make_shared<const Memory>(memory);
+    snapshot.id = nextId.fetch_add(1, std::memory_order_relaxed);
+    memory.track(snapshot.id);
+    return snapshot;
+}
+
+Snapshot Snapshot::delta(const Cpu &cpu, Memory &memory) const {
+    Snapshot snapshot;
+    snapshot.registers = cpu.saveState();
+    snapshot.base = base;
+    snapshot.id = id;
+    snapshot.incremental = true;
+
+    if (!base || memory.baseline != id) {
+        //Memory was reloaded or tracks another snapshot, every page may differ
+        Emulator::log(cpu.saveState().totalCycles, Emulator::WARNING, "Delta snapshot without its base, keeping all pages");
+        for (uint32_t page = 0; page < 256; page++) {
+            snapshot.changed.push_back({static_cast<Byte>(page), memory.sharePage(static_cast<Byte>(page))});
+        }
+        return snapshot;
+    }
+    for (uint32_t word = 0; word < 4; word++) {
+        for (uint64_t bits = memory.dirtyPages[word]; bits != 0; bits &= bits - 1) {
+            const auto page = static_cast<Byte>(word * 64 + std::countr_zero(bits));
+            snapshot.changed.push_back({page, memory.sharePage(page)});
+        }
+    }
+    return snapshot;
+}
+
+void Snapshot::restore(Cpu &cpu, Memory &memory) const {
+    if (!base) {
+        Emulator::log(cpu.saveState().totalCycles, Emulator::ERROR, "Restoring an empty snapshot");
+        return;
+    }
+
+    //Pages that may differ from what the snapshot holds
+    uint64_t stale[4] = {~uint64_t{0}, ~uint64_t{0}, ~uint64_t{0}, ~uint64_t{0}};
+    if (memory.baseline == id) {
+        for (uint32_t word = 0; word < 4; word++) {
+            stale[word] = memory.dirtyPages[word];
+        }
+    }
+    for (const Page &page : changed) {
+        stale[page.index >> 6] |= uint64_t{1} << (page.index & 63);
+    }
+
+    //The delta's own pages count as dirty relative to the base from here on
+    memory.track(id);
+    size_t next = 0;
+    for (uint32_t word = 0; word < 4; word++) {
+        for (uint64_t bits = stale[word]; bits != 0; bits &= bits - 1) {
+            const auto page = static_cast<Byte>(word * 64 + std::countr_zero(bits));
+            while (next < changed.size() && changed[next].index < page) {
+                next++;
+            }
+            if (next < changed.size() && changed[next].index == page) {
+                memory.replacePage(page, changed[next].bytes);
+                memory.dirtyPages[word] |= uint64_t{1} << (page & 63);
+                memory.pageFlags[page] &= ~Memory::TRACKED;
+            } else {
+                memory.replacePage(page, base->frames[page]);
+            }
+        }
+    }
+    cpu.loadState(registers);
+}
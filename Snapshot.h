@@ -0,0 +1,48 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CPU.h"
+#include "Memory.h"
+
+// Registers and memory at one point of a run. A full snapshot forks the memory
+// copy-on-write, so taking it copies no bytes, and from then on the memory
+// marks every page it writes in a dirty bitmap. Deltas keep only those pages
+// next to a reference to their full snapshot, and restoring rewrites only the
+// pages dirtied since the full snapshot plus the pages the delta holds.
+class Snapshot {
+private:
+    using Byte = unsigned char;
+
+public:
+    Snapshot() = default;
+
+    static Snapshot capture(const Cpu &cpu, Memory &memory);   //Full, restarts dirty tracking
+    [[nodiscard]] Snapshot delta(const Cpu &cpu, Memory &memory) const; //Pages dirtied since our full snapshot
+    void restore(Cpu &cpu, Memory &memory) const;
+
+    [[nodiscard]] const Cpu::State &state() const { return registers; }
+    [[nodiscard]] bool isDelta() const { return incremental; }
+    [[nodiscard]] size_t pages() const { return incremental ? changed.size() : base ? 256 : 0; }
+
+private:
+    struct Page {
+        Byte index;
+        std::shared_ptr<Byte[]> bytes;
+    };
+
+    Cpu::State registers{};
+    std::shared_ptr<const Memory> base;                        //Memory of the full snapshot
+    uint64_t id = 0;                                           //Of the full snapshot, matches Memory::baseline
+    std::vector<Page> changed;                                 //Delta pages, ordered by index
+    bool incremental = false;
+};
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,259 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#include "Trace.h"
+#include <chrono>
+#include <cstring>
+#include "Emulator.h"
+
+#ifdef EMU_TRACE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+    constexpr uint8_t operandLength[256] = {
+#define OPCODE(code, handler, bytes, cycles) bytes,
+#include "Opcodes.def"
+#undef OPCODE
+    };
+
+    uint16_t nextPC(const TraceRecord &entry) {
+        return static_cast<uint16_t>(entry.PC + 1 + operandLength[entry.opcode]);
+    }
+}
+
+TraceSink::TraceSink(const std::string &path, const bool compress)
+    : ring(std::make_unique<TraceRecord[]>(RING_RECORDS)) {
+#ifdef EMU_TRACE_ZLIB
+    if (compress) {
+        gzip = gzopen(path.c_str(), "wb1"); //Fastest level, the writer has to keep up with the CPU
+    } else {
+        file = std::fopen(path.c_str(), "wb");
+    }
+#else
+    if (compress) {
+        Emulator::log(0, Emulator::WARNING, "Built without zlib, trace is not compressed: ", path);
+    }
+    file = std::fopen(path.c_str(), "wb");
+#endif
+    if (!isOpen()) {
+        Emulator::log(0, Emulator::ERROR, "Could not open trace file: ", path);
+        return;
+    }
+    write(TraceFormat::MAGIC, sizeof(TraceFormat::MAGIC));
+    encoded.reserve(BATCH_RECORDS * 10);
+    writer = std::thread(&TraceSink::drain, this);
+}
+
+TraceSink::~TraceSink() {
+    stopping.store(true, std::memory_order_release);
+    if (writer.joinable()) {
+        writer.join();
+    }
+#ifdef EMU_TRACE_ZLIB
+    if (gzip) {
+        gzclose(static_cast<gzFile>(gzip));
+    }
+#endif
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+void TraceSink::waitForSpace(const uint64_t position) {
+    while (position - (cachedTail = tail.load(std::memory_order_acquire)) == RING_RECORDS) {
+        if (!writer.joinable()) {
+            cachedTail++; //No writer, drop the oldest record
+            tail.store(cachedTail, std::memory_order_release);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void TraceSink::flush() {
+    const uint64_t target = head.load(std::memory_order_relaxed);
+    if (!writer.joinable()) {
+        return;
+    }
+    flushRequest.store(target, std::memory_order_release);
+    while (flushed.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
+}
+
+void TraceSink::write(const void *data, const size_t size) {
+#ifdef EMU_TRACE_ZLIB
+    if (gzip) {
+        gzwrite(static_cast<gzFile>(gzip), data, static_cast<unsigned>(size));
+        return;
+    }
+#endif
+    std::fwrite(data, 1, size, file);
+}
+
+void TraceSink::encode(const TraceRecord &entry) {
+    const uint64_t delta = entry.totalCycles - previous.totalCycles;
+    uint8_t header = 0;
+    if (entry.PC != nextPC(previous)) header |= TraceFormat::PC;
+    if (entry.A != previous.A) header |= TraceFormat::A;
+    if (entry.X != previous.X) header |= TraceFormat::X;
+    if (entry.Y != previous.Y) header |= TraceFormat::Y;
+    if (entry.SP != previous.SP) header |= TraceFormat::SP;
+    if (entry.status != previous.status) header |= TraceFormat::STATUS;
+    if (delta != previousDelta) header |= TraceFormat::CYCLES;
+
+    encoded.push_back(header);
+    encoded.push_back(entry.opcode);
+    if (operandLength[entry.opcode] >= 1) encoded.push_back(static_cast<uint8_t>(entry.operand));
+    if (operandLength[entry.opcode] == 2) encoded.push_back(static_cast<uint8_t>(entry.operand >> 8));
+    if (header & TraceFormat::PC) {
+        encoded.push_back(static_cast<uint8_t>(entry.PC));
+        encoded.push_back(static_cast<uint8_t>(entry.PC >> 8));
+    }
+    if (header & TraceFormat::A) encoded.push_back(entry.A);
+    if (header & TraceFormat::X) encoded.push_back(entry.X);
+    if (header & TraceFormat::Y) encoded.push_back(entry.Y);
+    if (header & TraceFormat::SP) encoded.push_back(entry.SP);
+    if (header & TraceFormat::STATUS) encoded.push_back(entry.status);
+    if (header & TraceFormat::CYCLES) {
+        uint64_t value = delta; //LEB128
+        do {
+            encoded.push_back(static_cast<uint8_t>((value & 0x7F) | (value > 0x7F ? 0x80 : 0)));
+            value >>= 7;
+        } while (value);
+    }
+
+    previous = entry;
+    previousDelta = delta;
+}
+
+void TraceSink::drain() {
+    while (true) {
+        const bool last = stopping.load(std::memory_order_acquire);
+        const uint64_t position = tail.load(std::memory_order_relaxed);
+        const uint64_t available = head.load(std::memory_order_acquire) - position;
+        const uint64_t count = available < BATCH_RECORDS ? available : BATCH_RECORDS;
+
+        for (uint64_t i = 0; i < count; i++) {
+            encode(ring[(position + i) & (RING_RECORDS - 1)]);
+        }
+        if (count) {
+            tail.store(position + count, std::memory_order_release);
+            write(encoded.data(), encoded.size());
+            encoded.clear();
+        }
+
+        const uint64_t requested = flushRequest.load(std::memory_order_acquire);
+        if (requested > flushed.load(std::memory_order_relaxed) && position + count >= requested) {
+#ifdef EMU_TRACE_ZLIB
+            if (gzip) gzflush(static_cast<gzFile>(gzip), Z_SYNC_FLUSH);
+#endif
+            if (file) std::fflush(file);
+            flushed.store(position + count, std::memory_order_release);
+        }
+
+        if (count == 0) {
+            if (last) {
+                return; //Everything recorded before the destructor ran is out
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+TraceReader::TraceReader(const std::string &path) {
+#ifdef EMU_TRACE_ZLIB
+    input = gzopen(path.c_str(), "rb"); //Reads plain files as they are
+#else
+    input = std::fopen(path.c_str(), "rb");
+#endif
+    if (!input) {
+        Emulator::log(0, Emulator::ERROR, "Could not open trace file: ", path);
+        return;
+    }
+    char magic[sizeof(TraceFormat::MAGIC)];
+    for (char &c : magic) {
+        c = static_cast<char>(get());
+    }
+    if (std::memcmp(magic, TraceFormat::MAGIC, sizeof(magic)) != 0) {
+        Emulator::log(0, Emulator::ERROR, magic[0] == '\x1f' ? "Compressed trace, build with zlib to read it: "
+                                                             : "Not a trace file: ", path);
+#ifdef EMU_TRACE_ZLIB
+        gzclose(static_cast<gzFile>(input));
+#else
+        std::fclose(static_cast<std::FILE*>(input));
+#endif
+        input = nullptr;
+    }
+}
+
+TraceReader::~TraceReader() {
+    if (input) {
+#ifdef EMU_TRACE_ZLIB
+        gzclose(static_cast<gzFile>(input));
+#else
+        std::fclose(static_cast<std::FILE*>(input));
+#endif
+    }
+}
+
+int TraceReader::get() {
+#ifdef EMU_TRACE_ZLIB
+    return gzgetc(static_cast<gzFile>(input));
+#else
+    return std::fgetc(static_cast<std::FILE*>(input));
+#endif
+}
+
+bool TraceReader::next(TraceRecord &entry) {
+    if (!input) {
+        return false;
+    }
+    const int header = get();
+    const int opcode = get();
+    if (header < 0 || opcode < 0) {
+        return false;
+    }
+
+    // Every byte of the record is read before any is checked
+    entry = previous;
+    entry.opcode = static_cast<uint8_t>(opcode);
+    entry.operand = 0;
+    int missing = 0;
+    const auto byte = [&]() {
+        const int value = get();
+        missing |= value;
+        return static_cast<uint8_t>(value);
+    };
+    if (operandLength[entry.opcode] >= 1) entry.operand = byte();
+    if (operandLength[entry.opcode] == 2) entry.operand |= byte() << 8;
+    entry.PC = nextPC(previous);
+    if (header & TraceFormat::PC) {
+        entry.PC = byte();
+        entry.PC |= byte() << 8;
+    }
+    if (header & TraceFormat::A) entry.A = byte();
+    if (header & TraceFormat::X) entry.X = byte();
+    if (header & TraceFormat::Y) entry.Y = byte();
+    if (header & TraceFormat::SP) entry.SP = byte();
+    if (header & TraceFormat::STATUS) entry.status = byte();
+    uint64_t delta = previousDelta;
+    if (header & TraceFormat::CYCLES) {
+        delta = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t part = byte();
+            delta |= static_cast<uint64_t>(part & 0x7F) << shift;
+            if (!(part & 0x80)) break;
+        }
+    }
+    if (missing < 0) {
+        return false;
+    }
+    entry.totalCycles = previous.totalCycles + delta;
+
+    previous = entry;
+    previousDelta = delta;
+    return true;
+}
@@ -0,0 +1,115 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per-instruction trace level of the CPU run loop. Picked at build time with
+// the EMU_TRACE CMake option; OFF compiles every trace statement out.
+enum class TraceLevel {OFF, TEXT, BINARY};
+
+#ifndef EMU_TRACE_LEVEL
+#define EMU_TRACE_LEVEL OFF
+#endif
+
+constexpr TraceLevel defaultTraceLevel = TraceLevel::EMU_TRACE_LEVEL;
+
+// State before an instruction runs, as the CPU hands it to the sink
+struct TraceRecord {
+    uint16_t PC;      //Address of the opcode
+    uint8_t opcode;
+    uint16_t operand; //Operand bytes, little endian
+    uint8_t A, X, Y, SP;
+    uint8_t status;   //Flags as pushed by PHP
+    uint64_t totalCycles;
+    bool operator==(const TraceRecord&) const = default;
+};
+
+// Binary trace file. Records pass through a single-producer ring to a writer
+// thread, which delta-encodes them against the previous record: a header byte
+// says which of PC (when not simply the next instruction), A, X, Y, SP, status
+// and the cycle delta (when it differs from the last one) follow the opcode
+// and its operand bytes. A typical record takes 3-5 bytes. Files start with
+// MAGIC; with zlib in the build (EMU_TRACE_ZLIB) the whole file can be written
+// as one gzip stream instead, which the reader recognises by itself.
+namespace TraceFormat {
+    constexpr char MAGIC[8] = {'6', '5', '0', '2', 'T', 'R', 'C', '1'};
+    enum Header : uint8_t {PC = 1, A = 2, X = 4, Y = 8, SP = 16, STATUS = 32, CYCLES = 64};
+}
+
+class TraceSink {
+private:
+    static constexpr size_t RING_RECORDS = 1 << 16; //Producer waits for the writer when it is full
+    static constexpr size_t BATCH_RECORDS = 4096;   //Encoded per write
+
+    std::FILE* file = nullptr;
+    void* gzip = nullptr;                           //gzFile when compressing
+    std::unique_ptr<TraceRecord[]> ring;
+    alignas(64) std::atomic<uint64_t> head{0};      //Next record to write, producer only
+    uint64_t cachedTail = 0;                        //Producer's last look at tail
+    alignas(64) std::atomic<uint64_t> tail{0};      //Next record to encode, writer only
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> flushRequest{0};          //flush() waits until flushed reaches this
+    std::atomic<uint64_t> flushed{0};
+    TraceRecord previous{};                         //Writer only: the delta base
+    uint64_t previousDelta = 0;
+    std::vector<uint8_t> encoded;
+    std::thread writer;
+
+    void drain();
+    void encode(const TraceRecord &entry);
+    void write(const void* data, size_t size);
+
+public:
+    explicit TraceSink(const std::string &path, bool compress = false);
+    ~TraceSink();
+
+    TraceSink(const TraceSink&) = delete;
+    TraceSink &operator=(const TraceSink&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return file != nullptr || gzip != nullptr; }
+
+    void record(const TraceRecord &entry) {
+        const uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - cachedTail == RING_RECORDS) [[unlikely]] {
+            waitForSpace(position);
+        }
+        ring[position & (RING_RECORDS - 1)] = entry;
+        head.store(position + 1, std::memory_order_release);
+    }
+    void flush();                                   //Blocks until everything recorded so far is in the file
+
+private:
+    void waitForSpace(uint64_t position);
+};
+
+// Reads a trace file back into full records
+class TraceReader {
+public:
+    explicit TraceReader(const std::string &path);
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader &operator=(const TraceReader&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return input != nullptr; }
+    bool next(TraceRecord &entry);                  //False at the end or on a damaged record
+
+private:
+    void* input = nullptr;                          //gzFile, or std::FILE* without zlib
+    TraceRecord previous{};
+    uint64_t previousDelta = 0;
+
+    int get();
+};
+
+#endif //TRACE_H
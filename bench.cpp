@@ -0,0 +1,486 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Host time per emulated instruction for every opcode and addressing mode, and
+// for a few whole programs, on each engine behind Cpu::execute. Results go to
+// stdout as one JSON document, so runs before and after a change can be diffed.
+//
+//   6502_bench [--engine interpreter|blocks|jit]... [--reps N] [--runs N] [--trials N]
+//              [--dormann 6502_functional_test.bin] [--success 3469] [--perf]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CPU.h"
+#include "Emulator.h"
+#include "Memory.h"
+#include "PerfCounters.h"
+
+using Byte = unsigned char;
+using Word = unsigned short;
+using Clock = std::chrono::steady_clock;
+
+static std::ostream results(std::cout.rdbuf()); //stdout; main() sends std::cout to stderr, next to the log
+
+struct Opcode {
+    Byte code;
+    std::string_view handler;
+    Byte bytes;
+};
+
+static constexpr Opcode opcodes[] = {
+#define OPCODE(code, handler, bytes, cycles) {code, #handler, bytes},
+#include "Opcodes.def"
+#undef OPCODE
+};
+
+struct Options {
+    std::vector<Cpu::Engine> engines;
+    int reps = 100;                          //Runs of each opcode block per trial
+    int runs = 3;                            //Runs of each program per trial
+    int trials = 5;                          //Best trial is reported
+    std::string dormann;                     //Functional test image, loaded at $0000
+    Word success = 0x3469;                   //PC the functional test traps at when it passes
+    int maxCycles = 200000000;
+    bool counters = false;                   //--perf
+    PerfCounters *perf = nullptr;            //Host counters for the program runs
+};
+
+static const char *engineName(const Cpu::Engine engine) {
+    switch (engine) {
+        case Cpu::Engine::BLOCK_CACHE: return "blocks";
+        case Cpu::Engine::JIT: return "jit";
+        default: return "interpreter";
+    }
+}
+
+static std::string hex(const unsigned value, const int width) {
+    std::stringstream text;
+    text << std::hex << std::uppercase << std::setw(width) << std::setfill('0') << value;
+    return text.str();
+}
+
+// Straight-line 6502 code with forward and backward labels. Every label gets a
+// NOP in front of it, so a branch that lands one byte short of its target runs
+// the same instructions as one that lands on it.
+class Program {
+public:
+    explicit Program(const Word origin) : origin(origin) {}
+
+    Program &op(const Byte opcode) { code.push_back(opcode); return *this; }
+    Program &op(const Byte opcode, const Byte value) { return op(opcode).op(value); }
+    Program &op(const Byte opcode, const Word value) {
+        return op(opcode).op(static_cast<Byte>(value & 0xFF)).op(static_cast<Byte>(value >> 8));
+    }
+
+    Program &label(const std::string &name) {
+        op(0xEA);
+        labels[name] = address();
+        return *this;
+    }
+    Program &branch(const Byte opcode, const std::string &name) {
+        op(opcode, Byte{0});
+        fixups.push_back({code.size() - 1, name, true});
+        return *this;
+    }
+    Program &jump(const Byte opcode, const std::string &name) {
+        op(opcode, Word{0});
+        fixups.push_back({code.size() - 2, name, false});
+        return *this;
+    }
+
+    [[nodiscard]] Word address() const { return static_cast<Word>(origin + code.size()); }
+
+    void load(Memory &memory) {
+        for (const Fixup &fixup : fixups) {
+            const Word target = labels.at(fixup.label);
+            if (fixup.relative) {
+                code[fixup.at] = static_cast<Byte>(target - (origin + fixup.at + 1));
+            } else {
+                code[fixup.at] = static_cast<Byte>(target & 0xFF);
+                code[fixup.at + 1] = static_cast<Byte>(target >> 8);
+            }
+        }
+        for (size_t i = 0; i < code.size(); i++) {
+            memory[static_cast<Word>(origin + i)] = code[i];
+        }
+    }
+
+private:
+    struct Fixup {
+        size_t at;
+        std::string label;
+        bool relative;
+    };
+    Word origin;
+    std::vector<Byte> code;
+    std::map<std::string, Word> labels;
+    std::vector<Fixup> fixups;
+};
+
+// Times reps runs from the same start state and keeps the best of the trials.
+// Returns the nanoseconds of one run; the state after the last run is left in cpu.
+static double timeRuns(Cpu &cpu, Memory &memory, const Cpu::State &start, const int budget, const int reps,
+                       const Options &options) {
+    cpu.loadState(start);
+    cpu.execute(budget, memory); //Warm up, the block cache and the JIT compile here
+
+    double best = std::numeric_limits<double>::max();
+    for (int trial = 0; trial < options.trials; trial++) {
+        const auto begin = Clock::now();
+        for (int rep = 0; rep < reps; rep++) {
+            cpu.loadState(start);
+            cpu.execute(budget, memory);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - begin;
+        best = std::min(best, elapsed.count() / reps);
+    }
+    return best;
+}
+
+// Opcode benchmark layout
+static constexpr Word CODE = 0x8000;         //SLOTS copies of the instruction, then HLT
+static constexpr int SLOTS = 1000;
+static constexpr int VECTORS = 127;          //JMP (ind) slots, one vector each in the zero page
+static constexpr Word HANDLER = 0xF000;      //RTS for JSR, RTI for BRK
+static constexpr Byte ZERO_PAGE = 0x80;      //Operand of the zero page modes
+static constexpr Word ABSOLUTE = 0x0400;     //Operand of the absolute modes, and where every zero page pointer points
+
+// Flags that keep a branch from being taken. A taken branch needs a real target
+// and shows up in the program runs instead.
+static Byte notTaken(const Byte code) {
+    switch (code) {
+        case 0x10: return 0xA0;              //BPL, N set
+        case 0x30: return 0x20;              //BMI
+        case 0x50: return 0x60;              //BVC, V set
+        case 0x70: return 0x20;              //BVS
+        case 0x90: return 0x21;              //BCC, C set
+        case 0xB0: return 0x20;              //BCS
+        case 0xD0: return 0x22;              //BNE, Z set
+        case 0xF0: return 0x20;              //BEQ
+        default: return 0x20;
+    }
+}
+
+static void benchOpcode(const Opcode &opcode, const Cpu::Engine engine, const Options &options, bool &first) {
+    const std::string_view handler = opcode.handler;
+    const size_t bracket = handler.find('<');
+    const std::string mnemonic(handler.substr(0, 3));
+    std::string mode = bracket == std::string_view::npos
+                           ? (opcode.bytes == 1 ? "REL" : opcode.bytes == 2 ? "ABS" : "IMP")
+                           : std::string(handler.substr(bracket + 1, handler.size() - bracket - 2));
+
+    //Returns and BRK need their partner, so they are timed as pairs
+    const int slots = mode == "IN" ? VECTORS : SLOTS;
+    int perSlot = 1;
+    std::string name = mnemonic;
+    if (mnemonic == "JSR" || mnemonic == "BRK") {
+        name += mnemonic == "JSR" ? "+RTS" : "+RTI";
+        perSlot = 2;
+    }
+
+    Memory memory;
+    for (int i = 0; i < 0x100; i++) {
+        memory[static_cast<Word>(i)] = static_cast<Byte>(ABSOLUTE >> 8); //Every pointer reads $0404
+    }
+    memory[HANDLER] = mnemonic == "JSR" ? 0x60 : 0x40;
+    memory[0xFFFE] = static_cast<Byte>(HANDLER & 0xFF);
+    memory[0xFFFF] = static_cast<Byte>(HANDLER >> 8);
+
+    Word pc = CODE;
+    for (int slot = 0; slot < slots; slot++) {
+        const auto next = static_cast<Word>(pc + 1 + opcode.bytes);
+        Word value = 0x01;
+        if (mnemonic == "JSR") {
+            value = HANDLER;
+        } else if (mode == "IN") {
+            value = static_cast<Word>(2 * slot);
+            memory[value] = static_cast<Byte>(next & 0xFF);
+            memory[static_cast<Word>(value + 1)] = static_cast<Byte>(next >> 8);
+        } else if (mnemonic == "JMP") {
+            value = next;
+        } else if (mode == "ZP" || mode == "ZPX" || mode == "ZPY") {
+            value = ZERO_PAGE;
+        } else if (mode == "ABS" || mode == "ABX" || mode == "ABY") {
+            value = ABSOLUTE;
+        } else if (mode == "INDX" || mode == "INDY") {
+            value = ZERO_PAGE;
+        }
+        memory[pc] = opcode.code;
+        if (opcode.bytes >= 1) {
+            memory[static_cast<Word>(pc + 1)] = static_cast<Byte>(value & 0xFF);
+        }
+        if (opcode.bytes == 2) {
+            memory[static_cast<Word>(pc + 2)] = static_cast<Byte>(value >> 8);
+        }
+        pc = next;
+    }
+    memory[pc] = 0xFF;
+
+    Cpu cpu(memory);
+    cpu.setEngine(engine);
+    const Cpu::State start{CODE, 0, 0, 0, 0xFF, notTaken(opcode.code), 0};
+    const double ns = timeRuns(cpu, memory, start, SLOTS * 16, options.reps, options);
+    const Cpu::State end = cpu.saveState();
+
+    const int instructions = slots * perSlot;
+    results << (first ? "" : ",\n") << std::fixed << std::setprecision(3)
+              << R"(    {"engine": ")" << engineName(engine) << R"(", "opcode": "0x)" << hex(opcode.code, 2)
+              << R"(", "mnemonic": ")" << name << R"(", "mode": ")" << mode
+              << R"(", "instructions": )" << instructions
+              << R"(, "cycles_per_instruction": )" << static_cast<double>(end.totalCycles) / instructions
+              << R"(, "ns_per_instruction": )" << ns / instructions
+              << R"(, "ok": )" << (end.PC == pc + 1 ? "true" : "false") << "}";
+    first = false;
+}
+
+// One more run from start, counted, and with host counters when there are any
+static PerfCounters::Reading countRun(Cpu &cpu, Memory &memory, const Cpu::State &start, const int budget,
+                                      const Options &options) {
+    cpu.loadState(start);
+    if (options.perf) {
+        return options.perf->execute(cpu, memory, budget);
+    }
+    PerfCounters::Reading reading;
+    const Cpu::Stats before = cpu.stats();
+    cpu.execute(budget, memory);
+    const Cpu::Stats after = cpu.stats();
+    reading.instructions = after.instructions - before.instructions;
+    reading.cycles = after.cycles - before.cycles;
+    return reading;
+}
+
+static void reportProgram(const std::string &name, const Cpu::Engine engine, const Word pc, const double ns,
+                          const PerfCounters::Reading &counted, const bool ok, bool &first) {
+    const auto cycles = static_cast<double>(counted.cycles);
+    const auto instructions = static_cast<double>(counted.instructions);
+    results << (first ? "" : ",\n") << std::fixed << std::setprecision(3)
+              << R"(    {"engine": ")" << engineName(engine) << R"(", "name": ")" << name
+              << R"(", "pc": "0x)" << hex(pc, 4)
+              << R"(", "instructions": )" << counted.instructions
+              << R"(, "cycles": )" << counted.cycles
+              << R"(, "ns": )" << ns
+              << R"(, "ns_per_instruction": )" << (instructions > 0 ? ns / instructions : 0)
+              << R"(, "ns_per_cycle": )" << (cycles > 0 ? ns / cycles : 0)
+              << R"(, "emulated_mhz": )" << (ns > 0 ? cycles * 1e3 / ns : 0);
+    const std::pair<const char *, PerfCounters::Event> fields[] = {
+        {"host_cycles_per_instruction", PerfCounters::HOST_CYCLES},
+        {"host_instructions_per_instruction", PerfCounters::HOST_INSTRUCTIONS},
+        {"branch_misses_per_instruction", PerfCounters::BRANCH_MISSES},
+        {"l1d_misses_per_instruction", PerfCounters::L1D_MISSES},
+    };
+    for (const auto &[field, event] : fields) {
+        if (counted.valid[event]) {
+            results << R"(, ")" << field << R"(": )" << counted.perInstruction(event);
+        }
+    }
+    if (counted.hostIPC() > 0) {
+        results << R"(, "host_ipc": )" << counted.hostIPC();
+    }
+    results << R"(, "ok": )" << (ok ? "true" : "false") << "}";
+    first = false;
+}
+
+// Counts the primes below 8192 with one flag byte per number at $4000-$5FFF.
+// The count ends up in $16/$17.
+static Program sieve() {
+    Program p(0x0200);
+    p.op(0xA9, Byte{0x00}).op(0x85, Byte{0x10}).op(0x85, Byte{0x16}).op(0x85, Byte{0x17}) //LDA #0, STA p, count
+     .op(0xA9, Byte{0x40}).op(0x85, Byte{0x11})                                        //p = $4000
+     .op(0xA9, Byte{0x00}).op(0xA0, Byte{0x00}).op(0xA2, Byte{0x20})                   //LDA #0, LDY #0, LDX #32 pages
+     .label("clear").op(0x91, Byte{0x10}).op(0xC8).branch(0xD0, "clear")               //STA (p),Y, INY, BNE
+     .op(0xE6, Byte{0x11}).op(0xCA).branch(0xD0, "clear")                              //INC p+1, DEX, BNE
+     .op(0xA9, Byte{0x02}).op(0x85, Byte{0x14}).op(0xA9, Byte{0x00}).op(0x85, Byte{0x15}) //i = 2
+     .label("outer")
+     .op(0xA5, Byte{0x14}).op(0x85, Byte{0x10})                                        //p = $4000 + i
+     .op(0xA5, Byte{0x15}).op(0x18).op(0x69, Byte{0x40}).op(0x85, Byte{0x11})
+     .op(0xA0, Byte{0x00}).op(0xB1, Byte{0x10}).branch(0xD0, "next")                   //Marked, not a prime
+     .op(0xA5, Byte{0x16}).op(0x18).op(0x69, Byte{0x01}).op(0x85, Byte{0x16})          //count++
+     .op(0xA5, Byte{0x17}).op(0x69, Byte{0x00}).op(0x85, Byte{0x17})
+     .op(0xA5, Byte{0x15}).branch(0xD0, "next")                                        //Only i < 91 marks, 91 * 91 > 8192
+     .op(0xA5, Byte{0x14}).op(0xC9, Byte{91}).branch(0xB0, "next")
+     .op(0xA5, Byte{0x10}).op(0x18).op(0x65, Byte{0x14}).op(0x85, Byte{0x12})          //q = p + i
+     .op(0xA5, Byte{0x11}).op(0x65, Byte{0x15}).op(0x85, Byte{0x13})
+     .label("mark")
+     .op(0xA5, Byte{0x13}).op(0xC9, Byte{0x60}).branch(0xB0, "next")                   //Until q reaches $6000
+     .op(0xA9, Byte{0x01}).op(0x91, Byte{0x12})                                        //LDA #1, STA (q),Y
+     .op(0xA5, Byte{0x12}).op(0x18).op(0x65, Byte{0x14}).op(0x85, Byte{0x12})          //q += i
+     .op(0xA5, Byte{0x13}).op(0x65, Byte{0x15}).op(0x85, Byte{0x13})
+     .jump(0x4C, "mark")
+     .label("next")
+     .op(0xA5, Byte{0x14}).op(0x18).op(0x69, Byte{0x01}).op(0x85, Byte{0x14})          //i++
+     .op(0xA5, Byte{0x15}).op(0x69, Byte{0x00}).op(0x85, Byte{0x15})
+     .op(0xA5, Byte{0x15}).op(0xC9, Byte{0x20}).branch(0xF0, "done")                   //Until i reaches 8192
+     .jump(0x4C, "outer")
+     .label("done").op(0xFF);
+    return p;
+}
+
+// Copies 16 KB from $1000 to $5000 through two zero page pointers
+static Program memcpy16k() {
+    Program p(0x0200);
+    p.op(0xA9, Byte{0x00}).op(0x85, Byte{0x10}).op(0x85, Byte{0x12})                   //Source and destination low bytes
+     .op(0xA9, Byte{0x10}).op(0x85, Byte{0x11}).op(0xA9, Byte{0x50}).op(0x85, Byte{0x13})
+     .op(0xA2, Byte{0x40}).op(0xA0, Byte{0x00})                                        //64 pages
+     .label("copy").op(0xB1, Byte{0x10}).op(0x91, Byte{0x12}).op(0xC8).branch(0xD0, "copy") //LDA (src),Y, STA (dst),Y
+     .op(0xE6, Byte{0x11}).op(0xE6, Byte{0x13}).op(0xCA).branch(0xD0, "copy")
+     .op(0xFF);
+    return p;
+}
+
+static void benchProgram(const std::string &name, Program program, const Cpu::Engine engine, const Options &options,
+                         bool &first) {
+    Memory memory;
+    program.load(memory);
+    if (name == "memcpy") {
+        for (int i = 0; i < 0x4000; i++) {
+            memory[static_cast<Word>(0x1000 + i)] = static_cast<Byte>(i * 7);
+        }
+    }
+
+    Cpu cpu(memory);
+    cpu.setEngine(engine);
+    const Cpu::State start{0x0200, 0, 0, 0, 0xFF, 0x20, 0};
+    const double ns = timeRuns(cpu, memory, start, options.maxCycles, options.runs, options);
+    const PerfCounters::Reading counted = countRun(cpu, memory, start, options.maxCycles, options);
+    const Cpu::State end = cpu.saveState();
+
+    bool ok = end.PC == program.address();
+    if (name == "sieve") {
+        ok = ok && (memory[0x16] | memory[0x17] << 8) == 1028;
+    } else {
+        for (int i = 0; i < 0x4000 && ok; i++) {
+            ok = memory[static_cast<Word>(0x5000 + i)] == static_cast<Byte>(i * 7);
+        }
+    }
+    reportProgram(name, engine, end.PC, ns, counted, ok, first);
+}
+
+// Klaus Dormann's 6502 functional test. It starts at $0400 and ends in a jump
+// to itself: at the success address when every test passed, anywhere else on
+// the first failure.
+static void benchDormann(const Cpu::Engine engine, const Options &options, bool &first) {
+    Memory memory;
+    if (!Emulator::mapROM(memory, options.dormann, 0x0000, false)) {
+        return;
+    }
+    Cpu cpu(memory);
+    cpu.setEngine(engine);
+    cpu.loadState({0x0400, 0, 0, 0, 0xFF, 0x20, 0});
+
+    constexpr int SLICE = 997; //Prime, so a loop rarely ends two slices at the same PC
+    Word last = 0;
+    PerfCounters::Reading counted;
+    const auto begin = Clock::now();
+    while (cpu.stats().cycles < static_cast<uint64_t>(options.maxCycles)) {
+        if (options.perf) {
+            counted += options.perf->execute(cpu, memory, SLICE);
+        } else {
+            cpu.execute(SLICE, memory);
+        }
+        if (cpu.PC == last) {
+            break;
+        }
+        last = cpu.PC;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - begin;
+
+    const Cpu::Stats stats = cpu.stats();
+    counted.instructions = stats.instructions;
+    counted.cycles = stats.cycles;
+    reportProgram("dormann", engine, cpu.PC, elapsed.count(), counted, cpu.PC == options.success, first);
+}
+
+static bool parse(const int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--perf") {
+            options.counters = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            Emulator::log(0, Emulator::ERROR, "Missing value for ", arg);
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--engine") {
+            if (value == "interpreter") {
+                options.engines.push_back(Cpu::Engine::INTERPRETER);
+            } else if (value == "blocks") {
+                options.engines.push_back(Cpu::Engine::BLOCK_CACHE);
+            } else if (value == "jit") {
+                options.engines.push_back(Cpu::Engine::JIT);
+            } else {
+                Emulator::log(0, Emulator::ERROR, "Unknown engine: ", value);
+                return false;
+            }
+        } else if (arg == "--reps") {
+            options.reps = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--runs") {
+            options.runs = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--trials") {
+            options.trials = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--dormann") {
+            options.dormann = value;
+        } else if (arg == "--success") {
+            options.success = static_cast<Word>(std::strtoul(value.c_str(), nullptr, 16));
+        } else {
+            Emulator::log(0, Emulator::ERROR, "Unknown option: ", arg);
+            return false;
+        }
+    }
+    if (options.engines.empty()) {
+        options.engines = {Cpu::Engine::INTERPRETER, Cpu::Engine::BLOCK_CACHE, Cpu::Engine::JIT};
+    }
+    return true;
+}
+
+int main(const int argc, char **argv) {
+    std::cout.rdbuf(std::cerr.rdbuf());
+    Options options;
+    if (!parse(argc, argv, options)) {
+        return 1;
+    }
+    std::unique_ptr<PerfCounters> perf;
+    if (options.counters) {
+        perf = std::make_unique<PerfCounters>();
+        options.perf = perf.get();
+    }
+#ifndef __OPTIMIZE__
+    Emulator::log(0, Emulator::WARNING, "Unoptimized build, configure with -DCMAKE_BUILD_TYPE=Release");
+#endif
+
+    results << "{\n" << R"(  "slots": )" << SLOTS << R"(, "reps": )" << options.reps
+              << R"(, "runs": )" << options.runs << R"(, "trials": )" << options.trials << ",\n" << R"(  "opcodes": [)" << "\n";
+    bool first = true;
+    for (const Cpu::Engine engine : options.engines) {
+        for (const Opcode &opcode : opcodes) {
+            if (opcode.handler != "ILL" && opcode.handler != "HLT" && opcode.handler != "RTS" && opcode.handler != "RTI") {
+                benchOpcode(opcode, engine, options, first);
+            }
+        }
+    }
+
+    results << "\n  ],\n" << R"(  "programs": [)" << "\n";
+    first = true;
+    for (const Cpu::Engine engine : options.engines) {
+        benchProgram("sieve", sieve(), engine, options, first);
+        benchProgram("memcpy", memcpy16k(), engine, options, first);
+        if (!options.dormann.empty()) {
+            benchDormann(engine, options, first);
+        }
+    }
+    results << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -1,79 +1,274 @@
+// Headless front end for scripted runs. Maps the ROMs, runs until HLT ($FF),
+// a given PC or a cycle budget, and writes one JSON summary at exit:
+//
+//   6502_emulator [--load ADDR] rom.bin[@ADDR]... [--reset ADDR] [--until-pc ADDR]
+//                 [--cycles N] [--dump START:END[=file]]... [--engine interpreter|blocks|jit]
+//                 [--json summary.json]
+//
+// Addresses are hex ($C000, 0xC000 or C000), dump ranges inclusive. Log
+// output goes to stderr, so stdout carries nothing but the summary.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 #include "CPU.h"
 #include "Emulator.h"
 #include "Memory.h"
 
-int main() {
-    Emulator emulator;
+using Byte = unsigned char;
+using Word = unsigned short;
 
-    // std::vector<uint8_t> testProgram = {
-    //     0xA9, 0x10,       // LDA #$10
-    //     0xAA,             // TAX
-    //     0xE8,             // INX
-    //     0xCA,             // DEX
-    //
-    //     0xA0, 0x05,       // LDY #$05
-    //     0xC8,             // INY
-    //     0x88,             // DEY
-    //
-    //     0x8D, 0x00, 0x02, // STA $0200
-    //
-    //     0xA9, 0x22,       // LDA #$22
-    //     0x69, 0x20,       // ADC #$20
-    //
-    //     0x29, 0xF0,       // AND #$F0
-    //     0x09, 0x02,       // ORA #$02
-    //     0x49, 0x01,       // EOR #$01
-    //
-    //     0x4A,             // LSR
-    //     0x0A,             // ASL
-    //     0x2A,             // ROL
-    //     0x6A,             // ROR
-    //
-    //     0xC9, 0x42,       // CMP #$42
-    //     0xE0, 0x10,       // CPX #$10
-    //     0xC0, 0x05,       // CPY #$05
-    //
-    //     0xF0, 0x03,       // BEQ +3 (skocz jeśli Z=1)
-    //     0xA9, 0x00,       // LDA #$00 (pomijane)
-    //     0x4C, 0x29, 0x00, // JMP $0022 (jump to halt)
-    //
-    //     // label_eq:
-    //     0xA9, 0x42,       // LDA #$42
-    //
-    //     // halt:
-    //     0xFF              // HALT opcode
-    // };
-    //
-    // for (size_t i = 0; i < testProgram.size(); ++i)
-    //     emulator.mem[0x0000 + i] = testProgram[i];
-    //
-    // // Reset vector (adresy 0xFFFC-0xFFFD = 0x0000)
-    // emulator.loadByteIntoMem(0x00, 0xFFFC);
-    // emulator.loadByteIntoMem(0x00, 0xFFFD);
-    // emulator.cpu.reset(emulator.mem);
-
-    emulator.readROM("program.bin");
-    emulator.loadROMIntoMem(0x0000);
-    emulator.cpu.reset(emulator.mem);
+namespace {
+    constexpr int SLICE_CYCLES = 1 << 24; //Per execute() call when nothing has to be checked per instruction
+
+    struct Rom {
+        std::string path;
+        Word addr;
+    };
 
-    // Informacje początkowe
-    std::cout << "Reset vector PC: 0x" << std::hex << emulator.cpu.PC << std::endl;
-    std::cout << "First opcode: 0x" << std::hex << static_cast<int>(emulator.mem[emulator.cpu.PC]) << std::endl;
+    struct Dump {
+        Word start, end;
+        std::string file;                  //Raw bytes go here, or into the summary when empty
+    };
 
-    // Uruchom program
-    emulator.cpu.execute(100, emulator.mem);
+    struct Options {
+        std::vector<Rom> roms;
+        std::optional<Word> reset;
+        std::optional<Word> untilPC;
+        uint64_t cycles = std::numeric_limits<uint64_t>::max();
+        std::vector<Dump> dumps;
+        Cpu::Engine engine = Cpu::Engine::INTERPRETER;
+        std::string engineName = "interpreter";
+        std::string json;
+    };
+
+    bool parseAddress(const std::string &text, Word &addr) {
+        const size_t skip = text.rfind('$', 0) == 0 ? 1 : text.rfind("0x", 0) == 0 || text.rfind("0X", 0) == 0 ? 2 : 0;
+        char* end = nullptr;
+        const unsigned long value = std::strtoul(text.c_str() + skip, &end, 16);
+        if (text.size() == skip || *end != '\0' || value > 0xFFFF) {
+            Emulator::log(0, Emulator::ERROR, "Not an address: ", text);
+            return false;
+        }
+        addr = static_cast<Word>(value);
+        return true;
+    }
+
+    bool parse(const int argc, char **argv, Options &options) {
+        Word load = 0x0000;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                //rom.bin or rom.bin@ADDR
+                Rom rom{arg, load};
+                if (const size_t at = arg.rfind('@'); at != std::string::npos) {
+                    rom.path = arg.substr(0, at);
+                    if (!parseAddress(arg.substr(at + 1), rom.addr)) {
+                        return false;
+                    }
+                }
+                options.roms.push_back(rom);
+                continue;
+            }
+            if (i + 1 >= argc) {
+                Emulator::log(0, Emulator::ERROR, "Missing value for ", arg);
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--load") {
+                if (!parseAddress(value, load)) return false;
+            } else if (arg == "--reset") {
+                Word addr;
+                if (!parseAddress(value, addr)) return false;
+                options.reset = addr;
+            } else if (arg == "--until-pc") {
+                Word addr;
+                if (!parseAddress(value, addr)) return false;
+                options.untilPC = addr;
+            } else if (arg == "--cycles") {
+                if (!Emulator::parseCount(value, options.cycles)) return false;
+            } else if (arg == "--dump") {
+                Dump dump{};
+                const size_t colon = value.find(':');
+                const size_t equals = value.find('=');
+                if (colon == std::string::npos || !parseAddress(value.substr(0, colon), dump.start) ||
+                    !parseAddress(value.substr(colon + 1, equals == std::string::npos ? std::string::npos : equals - colon - 1), dump.end) ||
+                    dump.end < dump.start) {
+                    Emulator::log(0, Emulator::ERROR, "Dump range is START:END[=file]: ", value);
+                    return false;
+                }
+                if (equals != std::string::npos) {
+                    dump.file = value.substr(equals + 1);
+                }
+                options.dumps.push_back(dump);
+            } else if (arg == "--engine") {
+                if (value == "interpreter") {
+                    options.engine = Cpu::Engine::INTERPRETER;
+                } else if (value == "blocks") {
+                    options.engine = Cpu::Engine::BLOCK_CACHE;
+                } else if (value == "jit") {
+                    options.engine = Cpu::Engine::JIT;
+                } else {
+                    Emulator::log(0, Emulator::ERROR, "Unknown engine: ", value);
+                    return false;
+                }
+                options.engineName = value;
+            } else if (arg == "--json") {
+                options.json = value;
+            } else {
+                Emulator::log(0, Emulator::ERROR, "Unknown option: ", arg);
+                return false;
+            }
+        }
+        if (options.roms.empty()) {
+            std::cerr << "Usage: 6502_emulator [--load ADDR] rom.bin[@ADDR]... [--reset ADDR] [--until-pc ADDR]\n"
+                         "                     [--cycles N] [--dump START:END[=file]]... [--engine interpreter|blocks|jit]\n"
+                         "                     [--json summary.json]\n";
+            return false;
+        }
+        return true;
+    }
+
+    std::string jsonString(const std::string &text) {
+        std::string quoted = "\"";
+        for (const char c : text) {
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c); //Control characters are not allowed raw
+                quoted += escaped;
+                continue;
+            }
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+}
 
-    // Pokaż rejestry i flagi
-    emulator.showRegisters();
-    std::cout << "\nZawartosc $0201: 0x" << std::hex << static_cast<int>(emulator.mem[0x0201]) << std::endl;
+int main(const int argc, char **argv) {
+    std::ostream summary(std::cout.rdbuf()); //stdout, anything else printed to std::cout (the profile) goes to stderr
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    Options options;
+    if (!parse(argc, argv, options)) {
+        return 1;
+    }
+
+    Emulator emulator;
+    emulator.cpu.setEngine(options.engine);
+    for (size_t i = 0; i < options.roms.size(); i++) {
+        if (!emulator.mapROM(options.roms[i].path, options.roms[i].addr, i == 0)) { //The first ROM sets the reset vector
+            return 1;
+        }
+    }
+
+    std::unique_ptr<TraceSink> traceSink;
+    if constexpr (defaultTraceLevel == TraceLevel::BINARY) {
+        traceSink = std::make_unique<TraceSink>("trace.bin");
+        emulator.cpu.attachTraceSink(traceSink.get());
+    }
+
+    std::unique_ptr<Profiler> profiler;
+    if constexpr (profilingEnabled) {
+        profiler = std::make_unique<Profiler>();
+        if (std::ifstream("program.sym")) {
+            profiler->loadSymbols("program.sym");
+        }
+        emulator.cpu.attachProfiler(profiler.get());
+    }
+
+    emulator.cpu.reset(emulator.mem);
+    if (options.reset) {
+        Cpu::State state = emulator.cpu.saveState();
+        state.PC = *options.reset;
+        emulator.cpu.loadState(state);
+    }
 
+    // Stopping at a PC needs a look after every instruction, everything else
+    // runs in long slices and checks in between
+    std::string stop = "cycles";
+    const uint64_t first = emulator.cpu.stats().cycles;
+    uint64_t cycles = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    while (cycles < options.cycles) {
+        const int slice = options.untilPC ? 1 : static_cast<int>(std::min<uint64_t>(options.cycles - cycles, SLICE_CYCLES));
+        emulator.cpu.execute(slice, emulator.mem);
+        cycles = emulator.cpu.stats().cycles - first;
+        if (emulator.cpu.hasHalted()) {
+            stop = "halt";
+            break;
+        }
+        if (options.untilPC && emulator.cpu.PC == *options.untilPC) {
+            stop = "pc";
+            break;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const uint64_t instructions = emulator.cpu.stats().instructions;
 
-    emulator.showFlag(Cpu::z);  // Zero
-    emulator.showFlag(Cpu::c);  // Carry
-    emulator.showFlag(Cpu::n);  // Negative
+    if (traceSink) {
+        traceSink->flush();
+    }
+    if (profiler) {
+        profiler->hotSpots(std::cout);
+        std::ofstream stacks("profile.folded");
+        profiler->collapsedStacks(stacks);
+    }
 
-    emulator.showMemory(0x0000, 0x000D);
+    std::ofstream file;
+    if (!options.json.empty()) {
+        file.open(options.json);
+        if (!file) {
+            Emulator::log(0, Emulator::ERROR, "Could not write summary: ", options.json);
+            return 1;
+        }
+        summary.rdbuf(file.rdbuf());
+    }
 
+    const Cpu::State state = emulator.cpu.saveState();
+    summary << "{\n" << R"(  "roms": [)";
+    for (size_t i = 0; i < options.roms.size(); i++) {
+        summary << (i ? ", " : "") << jsonString(options.roms[i].path);
+    }
+    summary << "],\n"
+            << R"(  "engine": ")" << options.engineName << R"(", "stop": ")" << stop << "\",\n"
+            << R"(  "registers": {"pc": )" << state.PC << R"(, "a": )" << +state.A << R"(, "x": )" << +state.X
+            << R"(, "y": )" << +state.Y << R"(, "sp": )" << +state.SP << R"(, "status": )" << +state.status << "},\n"
+            << R"(  "instructions": )" << instructions << R"(, "cycles": )" << cycles
+            << R"(, "host_seconds": )" << std::fixed << std::setprecision(6) << seconds
+            << R"(, "mips": )" << std::setprecision(3) << (seconds > 0 ? static_cast<double>(instructions) / seconds / 1e6 : 0)
+            << ",\n" << R"(  "dumps": [)";
+    for (size_t i = 0; i < options.dumps.size(); i++) {
+        const Dump &dump = options.dumps[i];
+        summary << (i ? "," : "") << "\n" << R"(    {"start": )" << dump.start << R"(, "end": )" << dump.end;
+        if (dump.file.empty()) {
+            summary << R"(, "bytes": ")" << std::hex << std::setfill('0');
+            for (uint32_t addr = dump.start; addr <= dump.end; addr++) {
+                summary << std::setw(2) << +emulator.mem.readByte(static_cast<Word>(addr));
+            }
+            summary << std::dec << std::setfill(' ') << "\"}";
+        } else {
+            std::ofstream out(dump.file, std::ios::binary);
+            for (uint32_t addr = dump.start; addr <= dump.end; addr++) {
+                out.put(static_cast<char>(emulator.mem.readByte(static_cast<Word>(addr))));
+            }
+            if (!out) {
+                Emulator::log(0, Emulator::ERROR, "Could not write dump: ", dump.file);
+            }
+            summary << R"(, "file": )" << jsonString(dump.file) << "}";
+        }
+    }
+    summary << (options.dumps.empty() ? "" : "\n  ") << "]\n}" << std::endl;
     return 0;
 }
@@ -0,0 +1,91 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CPU.h"
+#include "Memory.h"
+
+// Shared by the tests: runs an image on one engine and compares what two runs
+// left behind. Every run forks the image, so runs never see each other's writes.
+namespace harness {
+    using Byte = unsigned char;
+    using Word = unsigned short;
+
+    struct Outcome {
+        Cpu::State state;
+        uint64_t instructions;
+        std::vector<Byte> memory;               //All 64 KB
+    };
+
+    // execute() once per slice, so odd budgets and block boundaries get exercised too
+    inline Outcome run(const Memory &image, const Cpu::Engine engine, const std::vector<int> &slices) {
+        Memory memory(image);
+        Cpu cpu(memory);
+        cpu.setEngine(engine);
+        cpu.reset(memory);
+        for (const int cycles : slices) {
+            cpu.execute(cycles, memory);
+        }
+
+        Outcome outcome{cpu.saveState(), cpu.stats().instructions, std::vector<Byte>(65536)};
+        for (uint32_t addr = 0; addr < 65536; addr++) {
+            outcome.memory[addr] = memory.readByte(static_cast<Word>(addr));
+        }
+        return outcome;
+    }
+
+    // FNV-1a over all of memory, for results recorded in a test
+    inline uint64_t checksum(const Outcome &outcome) {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (const Byte value : outcome.memory) {
+            hash = (hash ^ value) * 0x100000001B3;
+        }
+        return hash;
+    }
+
+    // Empty when both runs agree, otherwise the first differences
+    inline std::string compare(const Outcome &expected, const Outcome &actual) {
+        std::stringstream differences;
+        const auto field = [&](const char* name, const uint64_t want, const uint64_t got) {
+            if (want != got) {
+                differences << name << " " << std::hex << want << " != " << got << std::dec << "; ";
+            }
+        };
+        field("PC", expected.state.PC, actual.state.PC);
+        field("A", expected.state.A, actual.state.A);
+        field("X", expected.state.X, actual.state.X);
+        field("Y", expected.state.Y, actual.state.Y);
+        field("SP", expected.state.SP, actual.state.SP);
+        field("P", expected.state.status, actual.state.status);
+        field("totalCycles", expected.state.totalCycles, actual.state.totalCycles);
+        field("instructions", expected.instructions, actual.instructions);
+
+        int reported = 0;
+        for (uint32_t addr = 0; addr < expected.memory.size() && reported < 4; addr++) {
+            if (expected.memory[addr] != actual.memory[addr]) {
+                differences << "$" << std::hex << addr << " " << +expected.memory[addr] << " != "
+                            << +actual.memory[addr] << std::dec << "; ";
+                reported++;
+            }
+        }
+        return differences.str();
+    }
+
+    inline const char* engineName(const Cpu::Engine engine) {
+        switch (engine) {
+            case Cpu::Engine::INTERPRETER: return "interpreter";
+            case Cpu::Engine::BLOCK_CACHE: return "blocks";
+            case Cpu::Engine::JIT: return "jit";
+        }
+        return "?";
+    }
+}
+
+#endif //HARNESS_H
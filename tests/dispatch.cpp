@@ -0,0 +1,89 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Runs dispatch.bin on the interpreter and checks registers, flags, totalCycles,
+// retired instructions and a checksum of memory at a few points against results
+// recorded from the table loop. The threaded loop (EMU_THREADED_DISPATCH) has to
+// reproduce them exactly. The image is 1 KB loaded at $0000 and starts at $0200;
+// its loop covers every addressing mode, branches taken and not, the stack, RMW
+// on memory, indirect jumps and the flag instructions. --record prints the
+// table again, for changes that are meant to alter what the interpreter does.
+//
+//   6502_test_dispatch dispatch.bin [--record]
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "Harness.h"
+
+using harness::Byte;
+using harness::Word;
+
+struct Checkpoint {
+    int cycles;                               //Budget of this slice
+    Word PC;
+    Byte A, X, Y, SP, status;
+    uint64_t totalCycles;
+    uint64_t instructions;
+    uint64_t checksum;
+    bool operator==(const Checkpoint&) const = default;
+};
+
+static constexpr Checkpoint expected[] = {
+    {1, 0x0202, 0x00, 0x00, 0x00, 0xFF, 0x22, 2, 1, 0xE68864C11418F818},
+    {999, 0x024F, 0x21, 0x06, 0x04, 0xFF, 0xAC, 1003, 319, 0xE015BE769CD1D7DA},
+    {7777, 0x026D, 0x32, 0x00, 0x00, 0xFF, 0x22, 8782, 2834, 0xC64E5FA95B03266A},
+    {100000, 0x0320, 0x0B, 0x06, 0x04, 0xFF, 0x30, 108786, 35078, 0xC91F0207C9182B0E},
+    {1234567, 0x0213, 0x81, 0x06, 0x04, 0xFF, 0xB0, 1343353, 433184, 0xFA81756ABA21BE42},
+};
+
+int main(const int argc, char* argv[]) {
+    if (argc < 2) {
+        std::printf("usage: 6502_test_dispatch dispatch.bin [--record]\n");
+        return 1;
+    }
+    const bool record = argc > 2 && std::strcmp(argv[2], "--record") == 0;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    const std::vector<char> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (rom.empty() || rom.size() > 0xFFFC) {
+        std::printf("cannot read %s\n", argv[1]);
+        return 1;
+    }
+    Memory image;
+    for (size_t i = 0; i < rom.size(); i++) {
+        image[static_cast<Word>(i)] = static_cast<Byte>(rom[i]);
+    }
+    image[0xFFFC] = 0x00;
+    image[0xFFFD] = 0x02;
+
+    //Every checkpoint runs from reset through all the slices up to it
+    std::vector<int> slices;
+    uint32_t failures = 0;
+    for (const int cycles : {1, 999, 7777, 100000, 1234567}) {
+        slices.push_back(cycles);
+        const harness::Outcome outcome = harness::run(image, Cpu::Engine::INTERPRETER, slices);
+        const Checkpoint actual{cycles, outcome.state.PC, outcome.state.A, outcome.state.X, outcome.state.Y,
+                                outcome.state.SP, outcome.state.status, outcome.state.totalCycles,
+                                outcome.instructions, harness::checksum(outcome)};
+        if (record) {
+            std::printf("    {%d, 0x%04X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X, %" PRIu64 ", %" PRIu64 ", 0x%016" PRIX64 "},\n",
+                        actual.cycles, actual.PC, actual.A, actual.X, actual.Y, actual.SP, actual.status,
+                        actual.totalCycles, actual.instructions, actual.checksum);
+            continue;
+        }
+
+        const size_t index = slices.size() - 1;
+        if (index >= std::size(expected) || !(expected[index] == actual)) {
+            std::printf("after %d cycles: PC %04X A %02X X %02X Y %02X SP %02X P %02X, %" PRIu64 " cycles, %"
+                        PRIu64 " instructions, memory %016" PRIX64 "\n", cycles, actual.PC, actual.A, actual.X,
+                        actual.Y, actual.SP, actual.status, actual.totalCycles, actual.instructions, actual.checksum);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Differential test of the engines behind Cpu::execute. Random programs run on
+// the interpreter, the block cache and the JIT, which must agree on registers,
+// flags, totalCycles, retired instructions and all of memory. Half of the
+// programs run in decimal mode, and every program rewrites some of its own
+// immediate operands while it loops.
+//
+//   6502_test_engines [programs] [first seed]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <vector>
+#include "Harness.h"
+#include "Log.h"
+
+using harness::Byte;
+using harness::Word;
+
+struct Opcode {
+    Byte code;
+    std::string_view handler;
+    Byte bytes;
+};
+
+static constexpr Opcode opcodes[] = {
+#define OPCODE(code, handler, bytes, cycles) {code, #handler, bytes},
+#include "Opcodes.def"
+#undef OPCODE
+};
+
+static constexpr Word CODE = 0x0200;          //Program, one page
+static constexpr Word DATA = 0x0300;          //Absolute operands and zero page pointers land in $0300-$08FF
+
+static bool isBranch(const std::string_view handler) {
+    return handler == "BPL" || handler == "BMI" || handler == "BVC" || handler == "BVS" ||
+           handler == "BCC" || handler == "BCS" || handler == "BNE" || handler == "BEQ";
+}
+
+// Control flow that would leave the program, and opcodes that do nothing useful
+static bool isExcluded(const std::string_view handler) {
+    return handler == "BRK" || handler == "JSR" || handler == "RTI" || handler == "RTS" ||
+           handler.starts_with("JMP") || handler == "HLT" || handler == "ILL";
+}
+
+// Init, a loop body of random instructions and a jump back to the body. Branches
+// land on instruction starts inside the body, and some absolute stores and RMWs
+// target the operand of an immediate instruction in the body.
+static Memory generate(const uint32_t seed) {
+    std::mt19937 random(seed);
+    const auto below = [&](const uint32_t limit) { return static_cast<uint32_t>(random() % limit); };
+
+    std::vector<const Opcode*> pool;
+    for (const Opcode &opcode : opcodes) {
+        if (!isExcluded(opcode.handler)) {
+            pool.push_back(&opcode);
+        }
+    }
+
+    Memory memory;
+    for (uint32_t addr = 0; addr < 0x100; addr++) {
+        memory[static_cast<Word>(addr)] = static_cast<Byte>(3 + below(5)); //Every pointer lands in the data
+    }
+    for (uint32_t addr = DATA; addr < 0x0900; addr++) {
+        memory[static_cast<Word>(addr)] = static_cast<Byte>(below(256));
+    }
+
+    std::vector<Byte> code = {0xA2, static_cast<Byte>(below(256)),   //LDX #
+                              0xA0, static_cast<Byte>(below(256)),   //LDY #
+                              0xA9, static_cast<Byte>(below(256)),   //LDA #
+                              static_cast<Byte>(seed & 1 ? 0xF8 : 0xD8)}; //SED or CLD
+    const auto body = static_cast<Word>(code.size());
+
+    std::vector<Word> starts;                 //Offsets of the body's instructions
+    std::vector<Word> immediates;             //Offsets of their immediate operands
+    std::vector<Word> branches, stores;       //Operands patched once the body is laid out
+    const uint32_t length = 8 + below(40);
+    for (uint32_t n = 0; n < length; n++) {
+        starts.push_back(static_cast<Word>(code.size()));
+        if (below(10) == 0) {
+            static constexpr Byte rewrite[] = {0x8D, 0x8E, 0x8C, 0xEE, 0xCE, 0x0E}; //STA STX STY INC DEC ASL abs
+            code.push_back(rewrite[below(std::size(rewrite))]);
+            stores.push_back(static_cast<Word>(code.size()));
+            code.push_back(0);
+            code.push_back(0);
+            continue;
+        }
+        const Opcode &opcode = *pool[below(static_cast<uint32_t>(pool.size()))];
+        code.push_back(opcode.code);
+        if (isBranch(opcode.handler)) {
+            branches.push_back(static_cast<Word>(code.size()));
+            code.push_back(0);
+        } else if (opcode.handler.ends_with("<IM>")) {
+            immediates.push_back(static_cast<Word>(code.size()));
+            code.push_back(static_cast<Byte>(below(256)));
+        } else if (opcode.bytes == 1) {
+            code.push_back(static_cast<Byte>(below(256)));
+        } else if (opcode.bytes == 2) {
+            const Word addr = DATA + below(0x0500);
+            code.push_back(static_cast<Byte>(addr & 0xFF));
+            code.push_back(static_cast<Byte>(addr >> 8));
+        }
+    }
+    code.push_back(0x4C); //JMP body
+    code.push_back(static_cast<Byte>((CODE + body) & 0xFF));
+    code.push_back(static_cast<Byte>((CODE + body) >> 8));
+
+    for (const Word operand : branches) {
+        //Cpu::branch adds offset - 1 to the PC after the operand
+        const int offset = starts[below(static_cast<uint32_t>(starts.size()))] - (operand + 1) + 1;
+        code[operand] = static_cast<Byte>(offset >= -128 && offset <= 127 ? offset : 1);
+    }
+    for (const Word operand : stores) {
+        const Word target = immediates.empty() ? DATA + below(0x0500)
+                                               : CODE + immediates[below(static_cast<uint32_t>(immediates.size()))];
+        code[operand] = static_cast<Byte>(target & 0xFF);
+        code[operand + 1] = static_cast<Byte>(target >> 8);
+    }
+
+    for (size_t i = 0; i < code.size(); i++) {
+        memory[static_cast<Word>(CODE + i)] = code[i];
+    }
+    for (const Word vector : {0xFFFA, 0xFFFC, 0xFFFE}) {
+        memory[vector] = CODE & 0xFF;
+        memory[static_cast<Word>(vector + 1)] = CODE >> 8;
+    }
+    return memory;
+}
+
+int main(const int argc, char* argv[]) {
+    const uint32_t programs = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 3000;
+    const uint32_t firstSeed = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+    //Zero page stores can bend a pointer into the code and leave unknown opcodes
+    //behind, which log every time they run. The comparison is what decides.
+    std::FILE* quiet = std::fopen("/dev/null", "w");
+    if (quiet) {
+        Log::setOutput(quiet);
+    }
+
+    //Long enough for the loop to get hot and run natively, split at odd budgets
+    const std::vector<int> slices = {4999, 1, 3, 15000};
+    uint32_t failures = 0;
+    for (uint32_t seed = firstSeed; seed < firstSeed + programs; seed++) {
+        const Memory image = generate(seed);
+        const harness::Outcome expected = harness::run(image, Cpu::Engine::INTERPRETER, slices);
+        for (const Cpu::Engine engine : {Cpu::Engine::BLOCK_CACHE, Cpu::Engine::JIT}) {
+            const std::string differences = harness::compare(expected, harness::run(image, engine, slices));
+            if (!differences.empty()) {
+                std::printf("seed %u, %s: %s\n", seed, harness::engineName(engine), differences.c_str());
+                failures++;
+            }
+        }
+    }
+
+    Log::flush();
+    std::printf("%u programs, %u mismatches\n", programs, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Submits more jobs than the farm's result queue holds, runs them and only polls
+// once run() has returned, the way a single-threaded caller would. Every job has
+// to come back once, ok and with the same state as the others.
+//
+//   6502_test_farm dispatch.bin
+
+#include <cstdio>
+#include <vector>
+#include "Farm.h"
+
+int main(const int argc, char* argv[]) {
+    if (argc < 2) {
+        std::printf("usage: 6502_test_farm dispatch.bin\n");
+        return 1;
+    }
+
+    static constexpr size_t CAPACITY = 16;
+    static constexpr size_t JOBS = 10 * CAPACITY;
+    Farm farm(4, CAPACITY);
+    for (size_t i = 0; i < JOBS; i++) {
+        Farm::Job job;
+        job.rom = argv[1];
+        job.loadAddress = 0x0000;
+        job.patches.push_back({0xFFFC, {0x00, 0x02}}); //dispatch.bin starts at $0200
+        job.cycles = 2000;
+        job.engine = static_cast<Cpu::Engine>(i % 3);
+        farm.submit(std::move(job));
+    }
+    farm.run();
+
+    std::vector<int> seen(JOBS, 0);
+    uint32_t failures = 0;
+    Farm::Result first{};
+    Farm::Result result;
+    size_t polled = 0;
+    while (farm.poll(result)) {
+        if (polled++ == 0) {
+            first = result;
+        }
+        if (result.job >= JOBS || seen[result.job]++ || !result.ok || !(result.state == first.state)) {
+            std::printf("job %zu: ok %d, PC %04X, %llu cycles\n", result.job, result.ok, result.state.PC,
+                        static_cast<unsigned long long>(result.state.totalCycles));
+            failures++;
+        }
+    }
+    if (polled != JOBS) {
+        std::printf("%zu of %zu results\n", polled, JOBS);
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
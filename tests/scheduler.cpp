@@ -0,0 +1,52 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Events that reschedule themselves at or before the cycle they fired at. A
+// zero period timer and a callback scheduling at now must each fire once per
+// pass, with the CPU still getting through its whole budget in between.
+
+#include <cstdio>
+#include <functional>
+#include "CPU.h"
+#include "Memory.h"
+
+int main() {
+    Memory memory;
+    memory[0x0200] = 0xEA;                              //NOP
+    memory[0x0201] = 0x4C;                              //JMP $0200
+    memory[0x0202] = 0x00;
+    memory[0x0203] = 0x02;
+    memory[0xFFFC] = 0x00;
+    memory[0xFFFD] = 0x02;
+    Cpu cpu(memory);
+
+    uint64_t timer = 0, immediate = 0, last = 0;
+    uint32_t failures = 0;
+    std::function<void(uint64_t)> tick = [&](const uint64_t now) {
+        timer++;
+        if (timer > 1 && now <= last) {
+            failures++;                                 //Fired twice in one pass
+        }
+        last = now;
+        cpu.events().schedule(now, tick);               //Period 0
+    };
+    std::function<void(uint64_t)> again = [&](const uint64_t now) {
+        immediate++;
+        cpu.events().schedule(now > 0 ? now - 1 : 0, again); //Already in the past
+    };
+    cpu.events().schedule(0, tick);
+    cpu.events().schedule(0, again);
+
+    static constexpr int CYCLES = 10000;
+    cpu.execute(CYCLES, memory);
+
+    const Cpu::Stats stats = cpu.stats();
+    if (stats.cycles < CYCLES || timer == 0 || timer > stats.instructions + 1 || immediate != timer) {
+        std::printf("%llu cycles, %llu instructions, timer fired %llu, immediate fired %llu\n",
+                    static_cast<unsigned long long>(stats.cycles), static_cast<unsigned long long>(stats.instructions),
+                    static_cast<unsigned long long>(timer), static_cast<unsigned long long>(immediate));
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
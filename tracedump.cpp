@@ -0,0 +1,81 @@
+//
+// Created by P!nk on 18.10.2026.
+//
+
+// Prints a binary trace written by TraceSink, one instruction per line:
+//
+//   6502_tracedump trace.bin [--skip N] [--count N]
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "Emulator.h"
+#include "Trace.h"
+
+static constexpr std::string_view handlers[256] = {
+#define OPCODE(code, handler, bytes, cycles) #handler,
+#include "Opcodes.def"
+#undef OPCODE
+};
+
+static constexpr uint8_t operandLength[256] = {
+#define OPCODE(code, handler, bytes, cycles) bytes,
+#include "Opcodes.def"
+#undef OPCODE
+};
+
+int main(const int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s trace.bin [--skip N] [--count N]\n", argv[0]);
+        return 1;
+    }
+    uint64_t skip = 0;
+    uint64_t count = UINT64_MAX;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        if (arg == "--skip") {
+            if (!Emulator::parseCount(argv[i + 1], skip)) return 1;
+        } else if (arg == "--count") {
+            if (!Emulator::parseCount(argv[i + 1], count)) return 1;
+        } else {
+            Emulator::log(0, Emulator::ERROR, "Unknown option: ", arg);
+            return 1;
+        }
+    }
+
+    TraceReader reader(argv[1]);
+    if (!reader.isOpen()) {
+        return 1;
+    }
+
+    TraceRecord entry{};
+    uint64_t index = 0;
+    while (count && reader.next(entry)) {
+        if (index++ < skip) {
+            continue;
+        }
+        count--;
+
+        // Handler names look like LDA<ZPX>, printed as "LDA ZPX"
+        const std::string_view handler = handlers[entry.opcode];
+        const size_t bracket = handler.find('<');
+        const std::string_view mnemonic = handler.substr(0, bracket);
+        const std::string_view mode = bracket == std::string_view::npos
+                                          ? std::string_view()
+                                          : handler.substr(bracket + 1, handler.size() - bracket - 2);
+
+        char operand[8] = "";
+        if (operandLength[entry.opcode] == 1) {
+            std::snprintf(operand, sizeof(operand), "%02X", entry.operand & 0xFF);
+        } else if (operandLength[entry.opcode] == 2) {
+            std::snprintf(operand, sizeof(operand), "%02X %02X", entry.operand & 0xFF, entry.operand >> 8);
+        }
+        std::printf("%10llu  %04X  %02X %-5s  %.*s %-4.*s  A=%02X X=%02X Y=%02X SP=%02X P=%02X\n",
+                    static_cast<unsigned long long>(entry.totalCycles), entry.PC, entry.opcode, operand,
+                    static_cast<int>(mnemonic.size()), mnemonic.data(),
+                    static_cast<int>(mode.size()), mode.data(),
+                    entry.A, entry.X, entry.Y, entry.SP, entry.status);
+    }
+    return 0;
+}